@@ -54,29 +54,33 @@ def read_mapped():
             codes_mapped[n] = val
 
 
-# currenty just a list - should probably do some hashed thing here instead
+# find a multiplier giving a collision free (perfect) hash for the
+# codes, trying larger tables until one is found
+def find_hash(codes):
+    for bits in range(6, 9): # max 256 slots, the index is a byte
+        for mul in range(1, 0x10000, 2):
+            slots = set()
+            for code in codes:
+                slots.add(((code * mul) & 0xffff) >> (16 - bits))
+            if len(slots) == len(codes):
+                return (bits, mul)
+    print("ERROR: found no perfect hash for the codes!")
+    sys.exit(1)
+
+
+# perfect hashed table, a lookup is one multiply, one table read and
+# one compare to verify the code (to catch unknown codes)
 def gen_file():
-    codes = []
-    vals = []
-
-    # maybe we should use some hashing or something, but in lieu of
-    # that, sort them, at least making it quicker to find digits
-    l = codes_mapped.items()
-    def sort_key((k, c)):
-        o = ord(c)
-        if c >= '0' and c <= '9':
-            return o
-        if c in ['-', '+', 'm', 'V', 'd', 'B']:
-            return o + 1000
-        return o+2000
-    l = sorted(l, key=sort_key)
-
-    codes = [c for (c, v) in l]
-    vals = [v for (c, v) in l]
-
-    #for code in codes_mapped.keys():
-    #    codes.append(code)
-    #    vals.append(codes_mapped[code])
+    codes = sorted(codes_mapped.keys())
+
+    (bits, mul) = find_hash(codes)
+    size = 1 << bits
+    table_codes = [0xffff] * size # 0xffff is never a valid code (0x0300 is not a segment)
+    table_vals = ['\\0'] * size
+    for code in codes:
+        h = ((code * mul) & 0xffff) >> (16 - bits)
+        table_codes[h] = code
+        table_vals[h] = codes_mapped[code]
 
     with open('segmapgen.c', 'w+') as f:
         print(g_copyright_notice, file=f)
@@ -85,15 +89,27 @@ def gen_file():
         print('#include <stdlib.h>', file=f)
         print('#include "hp_msg_parse.h"', file=f)
         print('', file=f)
+        print('#define SEG_HASH_MUL 0x%04x' % mul, file=f)
+        print('#define SEG_HASH_SHIFT %d' % (16 - bits), file=f)
+        print('', file=f)
         print('uint16_t seg_n = %d;' % len(codes), file=f)
-        print('uint16_t seg_codes[] = {', file=f)
-        for code in codes:
+        print('uint16_t seg_hash_size = %d;' % size, file=f)
+        print('const uint16_t seg_hash_codes[%d] PROGMEM = {' % size, file=f)
+        for code in table_codes:
             print('0x%04x, ' % code, file=f)
         print('};', file=f)
-        print('uint8_t seg_mapped_chars[] = {', file=f)
-        for val in vals:
-            print('\'%c\', ' % val, file=f)
+        print('const uint8_t seg_hash_chars[%d] PROGMEM = {' % size, file=f)
+        for val in table_vals:
+            print('\'%s\', ' % val, file=f)
         print('};', file=f)
+        print('', file=f)
+        print('/* map segments to character, null if not found */', file=f)
+        print('uint8_t seg_hash_lookup(uint16_t segs14) {', file=f)
+        print('  uint8_t h = ((uint16_t) (segs14 * SEG_HASH_MUL)) >> SEG_HASH_SHIFT;', file=f)
+        print('  if (pgm_read_word(&seg_hash_codes[h]) != segs14)', file=f)
+        print('    return \'\\0\';', file=f)
+        print('  return pgm_read_byte(&seg_hash_chars[h]);', file=f)
+        print('}', file=f)
 
 
 def main():
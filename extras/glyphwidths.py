@@ -0,0 +1,104 @@
+#!/bin/python
+
+from __future__ import division, absolute_import, print_function
+#, unicode_literals
+import os, sys, re, argparse
+
+g_copyright_notice = """
+/*
+ * hp_display - program for Arduino for replacing the display on some
+ * discontinued HP/Agilent/Keysight instruments.
+ * Copyright (C) 2019  Ragnar Sundblad
+ *
+ * This file is part of the hp_display program.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+"""
+
+#
+# Generate the glyph width (x advance) table of the characters in the
+# labels, for the OLED label line breaking, in
+# u8g2_font_helvB10_mod_widths.h. Run in the extras directory:
+#   python glyphwidths.py
+#
+
+# do not write bytecode (.pyc) files
+sys.dont_write_bytecode=True
+
+
+# x advance per encoding, from DWIDTH
+def read_bdf(fname):
+    widths = {}
+    encoding = None
+    with open(fname, 'r') as f:
+        for line in f:
+            w = line.split()
+            if not w:
+                continue
+            if w[0] == 'ENCODING':
+                encoding = int(w[1])
+            elif w[0] == 'DWIDTH' and encoding is not None:
+                widths[encoding] = int(w[1])
+            elif w[0] == 'ENDCHAR':
+                encoding = None
+    return widths
+
+
+# the characters in all the instrument profiles' labels, and space
+def read_label_chars(fname):
+    chars = set(' ')
+    with open(fname, 'r') as f:
+        src = f.read()
+    for m in re.finditer(r'::labels\[12\]\s*=\s*\{(.*?)\};', src, re.S):
+        for s in re.findall(r'"((?:[^"\\]|\\.)*)"', m.group(1)):
+            chars.update(s)
+    return chars
+
+
+def gen_file(fname, widths, chars):
+    codes = sorted(ord(c) for c in chars)
+    first = codes[0]
+    last = codes[-1]
+    with open(fname, 'w+') as f:
+        print(g_copyright_notice, file=f)
+        print('/* generated by extras/glyphwidths.py from helvB10-mod.bdf, do not edit */', file=f)
+        print('', file=f)
+        print('#define LABEL_GLYPH_FIRST 0x%02x' % first, file=f)
+        print('', file=f)
+        print('/* x advance of the label characters, from LABEL_GLYPH_FIRST, 0 if not a label character */', file=f)
+        print('const uint8_t label_glyph_widths[%d] PROGMEM = {' % (last - first + 1), file=f)
+        for code in range(first, last + 1):
+            if code in codes:
+                if code not in widths:
+                    print("ERROR: no glyph for 0x%02x in the font!" % code)
+                    sys.exit(1)
+                print('%2d, // \'%s\'' % (widths[code], chr(code)), file=f)
+            else:
+                print(' 0,', file=f)
+        print('};', file=f)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('-f', '--font', default='helvB10-mod.bdf', help='BDF font')
+    parser.add_argument('-s', '--source', default='../hp_msg_parse.cpp', help='file with the labels')
+    parser.add_argument('-o', '--output', default='../u8g2_font_helvB10_mod_widths.h', help='generated file')
+    args = parser.parse_args()
+
+    gen_file(args.output, read_bdf(args.font), read_label_chars(args.source))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,132 @@
+/*
+ * hp_display - program for Arduino for replacing the display on some
+ * discontinued HP/Agilent/Keysight instruments.
+ * Copyright (C) 2019  Ragnar Sundblad
+ *
+ * This file is part of the hp_display program.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Minimal Arduino API for building the decoder on a Linux host, just
+ * what hp_display_spi.cpp, hp_msg_parse.cpp and tft_spi.cpp use. The SPI registers
+ * read from the word being fed by host_feed_word(), Serial prints to
+ * stdout, and time, millis() and timer 0, moves host_word_us for
+ * every word fed, or with host_advance_us().
+ */
+
+#ifndef HOSTBENCH_ARDUINO_H
+#define HOSTBENCH_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <stdlib.h>
+
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define _BV(b) (1u << (b))
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define RISING 3
+#define HEX 16
+#define DEC 10
+
+#define SPE 6
+#define SPIE 7
+#define SPIF 7
+#define SPI_MODE3 0x0C
+#define TOV0 0
+#define ISR(v) void v(void)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern unsigned long host_ms; // what millis() returns
+extern unsigned long host_word_us; // time from one fed word to the next
+void host_advance_us(unsigned long us);
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+extern uint8_t SREG, SPCR, DDRF, PORTF, TCNT0, TIFR0;
+extern volatile unsigned long timer0_overflow_count;
+uint8_t host_spsr(void);
+uint8_t host_spdr(void);
+#define SPSR host_spsr()
+#define SPDR host_spdr()
+/* run the SPI interrupt routine with w, big endian as in doc/protocol_descr.txt */
+void host_feed_word(uint32_t w);
+/* TFT panel stand-in, tft_panel.cpp: the bytes tft_spi.cpp sends, dc 1 for data */
+void host_tft_write(uint8_t dc, uint8_t b);
+extern unsigned long host_tft_bytes, host_tft_pixels, host_tft_outside;
+int host_tft_save_ppm(const char *fname, uint16_t w, uint16_t h);
+#ifdef __cplusplus
+}
+
+typedef bool boolean;
+class __FlashStringHelper;
+#define F(s) ((const __FlashStringHelper *) (s))
+inline void noInterrupts() {}
+inline void interrupts() {}
+inline void cli() {}
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+#define digitalPinToInterrupt(p) (p)
+inline void attachInterrupt(uint8_t, void (*)(void), int) {}
+inline bool isPrintable(int c) { return isprint(c); }
+
+class Print {
+public:
+  size_t write(uint8_t c) { return fputc(c, stdout) != EOF; }
+  size_t write(const char *s) { return fputs(s, stdout); }
+  size_t write(const uint8_t *b, size_t n) { return fwrite(b, 1, n, stdout); }
+  size_t print(const char *s) { return fputs(s, stdout); }
+  size_t print(const __FlashStringHelper *s) { return fputs((const char *) s, stdout); }
+  size_t print(char c) { return fputc(c, stdout); }
+  size_t print(long n, int base = DEC) { return printf(base == 16 ? "%lX" : "%ld", n); }
+  size_t print(unsigned long n, int base = DEC) { return printf(base == 16 ? "%lX" : "%lu", n); }
+  size_t print(int n, int base = DEC) { return print((long) n, base); }
+  size_t print(unsigned int n, int base = DEC) { return print((unsigned long) n, base); }
+  size_t print(unsigned char n, int base = DEC) { return print((unsigned long) n, base); }
+  size_t print(signed char n, int base = DEC) { return print((long) n, base); }
+  size_t print(double d, int digits = 2) { return printf("%.*f", digits, d); }
+  size_t println() { return puts("") >= 0; }
+  template <class T> size_t println(T v) { size_t n = print(v); return n + println(); }
+  template <class T> size_t println(T v, int b) { size_t n = print(v, b); return n + println(); }
+};
+
+class HardwareSerial : public Print {
+public:
+  void begin(unsigned long) {}
+  int available() { return 0; }
+  int read() { return -1; }
+  int availableForWrite() { return 64; }
+  void flush() { fflush(stdout); }
+  operator bool() { return true; }
+};
+extern HardwareSerial Serial;
+
+#endif // __cplusplus
+
+#endif // HOSTBENCH_ARDUINO_H
@@ -0,0 +1,22 @@
+/*
+ * hp_display - program for Arduino for replacing the display on some
+ * discontinued HP/Agilent/Keysight instruments.
+ * Copyright (C) 2019  Ragnar Sundblad
+ *
+ * This file is part of the hp_display program.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* nothing needed, the SPI registers are in Arduino.h */
@@ -0,0 +1,68 @@
+/*
+ * hp_display - program for Arduino for replacing the display on some
+ * discontinued HP/Agilent/Keysight instruments.
+ * Copyright (C) 2019  Ragnar Sundblad
+ *
+ * This file is part of the hp_display program.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Host side of the Arduino shim: the registers, time, Serial, and
+ * feeding words through the SPI interrupt routine.
+ */
+
+#include "Arduino.h"
+
+extern "C" {
+uint8_t SREG, SPCR, DDRF, PORTF, TCNT0, TIFR0;
+volatile unsigned long timer0_overflow_count = 0;
+unsigned long host_ms = 0;
+unsigned long host_word_us = 976; // as the instruments
+static unsigned long host_us = 0;
+
+/* move time forward, timer 0 ticks every 4 us as with a 16 MHz clock */
+void host_advance_us(unsigned long us) {
+  host_us += us;
+  host_ms = host_us / 1000;
+  TCNT0 = host_us / 4;
+  timer0_overflow_count = host_us / 4 / 256;
+}
+
+unsigned long millis(void) { return host_ms; }
+unsigned long micros(void) { return host_us; }
+void delay(unsigned long ms) { host_advance_us(ms * 1000); }
+}
+
+HardwareSerial Serial;
+
+void spi_ss_pin_interrupt(); // in hp_display_spi.cpp
+
+/* the bytes of the word being fed, in SPI order */
+static uint8_t feed_bytes[4];
+static uint8_t feed_n = 4;
+
+/* run the SPI interrupt routine with w, big endian as in doc/protocol_descr.txt */
+extern "C" void host_feed_word(uint32_t w) {
+  for (uint8_t i = 0; i < 4; i++)
+    feed_bytes[i] = w >> (24 - 8 * i);
+  feed_n = 0;
+  host_advance_us(host_word_us);
+  spi_ss_pin_interrupt();
+}
+
+/* SPIF set while there are bytes left */
+extern "C" uint8_t host_spsr(void) { return feed_n < 4 ? _BV(SPIF) : 0; }
+extern "C" uint8_t host_spdr(void) { return feed_n < 4 ? feed_bytes[feed_n++] : 0; }
@@ -0,0 +1,250 @@
+/*
+ * hp_display - program for Arduino for replacing the display on some
+ * discontinued HP/Agilent/Keysight instruments.
+ * Copyright (C) 2019  Ragnar Sundblad
+ *
+ * This file is part of the hp_display program.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Stand-ins for the display libraries, hd44780 and u8g2, so that
+ * lcd_20x4_hd44780.cpp and oled_128x64.cpp can be run on the host
+ * and the bytes they send counted, independently of their own
+ * lcd_bytes and oled_bytes. The u8g2 part decodes the real font, for
+ * the glyph widths and the pixels, into a page buffer as u8g2 does,
+ * and counts the tiles sent with u8x8_DrawTile(). Headers in libs/.
+ */
+
+#include "Arduino.h"
+#include <Wire.h>
+#include <U8g2lib.h>
+#include <hd44780.h>
+
+TwoWire Wire;
+
+unsigned long host_lcd_bytes = 0;
+
+int hd44780::begin(uint8_t cols, uint8_t rows) {
+  return 0;
+}
+
+
+extern "C" {
+const u8g2_cb_t u8g2_cb_r0 = {0};
+unsigned long host_oled_bytes = 0;
+}
+
+static const u8x8_display_info_t display_128x64 = {16, 8};
+static uint8_t u8g2_buf[8 * 16 * 8]; // the largest, full frame, buffer
+
+U8G2::U8G2(uint8_t tile_buf_height) {
+  memset(&u8g2, 0, sizeof(u8g2));
+  u8g2.u8x8.display_info = &display_128x64;
+  u8g2.tile_buf_ptr = u8g2_buf;
+  u8g2.tile_buf_height = tile_buf_height;
+  u8g2.is_auto_page_clear = 1;
+  u8g2.draw_color = 1;
+  setMaxClipWindow();
+}
+
+/* as u8g2, begin() clears the display */
+void U8G2::begin() {
+  u8g2_ClearBuffer(&u8g2);
+  for (uint8_t row = 0; row < 8; row++)
+    u8x8_DrawTile(&u8g2.u8x8, 0, row, 16, u8g2_buf);
+}
+
+
+extern "C" {
+
+void u8x8_DrawTile(u8x8_t *u8x8, uint8_t x, uint8_t y, uint8_t cnt, uint8_t *tile_ptr) {
+  host_oled_bytes += cnt * 8;
+}
+
+void u8x8_RefreshDisplay(u8x8_t *u8x8) {}
+
+void u8g2_ClearBuffer(u8g2_t *u8g2) {
+  memset(u8g2->tile_buf_ptr, 0, 8 * u8g2->tile_buf_height * u8g2->u8x8.display_info->tile_width);
+}
+
+uint8_t *u8g2_GetBufferPtr(u8g2_t *u8g2) {
+  return u8g2->tile_buf_ptr;
+}
+
+void u8g2_SetBufferCurrTileRow(u8g2_t *u8g2, uint8_t row) {
+  u8g2->tile_curr_row = row;
+}
+
+void u8g2_FirstPage(u8g2_t *u8g2) {
+  if (u8g2->is_auto_page_clear)
+    u8g2_ClearBuffer(u8g2);
+  u8g2_SetBufferCurrTileRow(u8g2, 0);
+}
+
+/* send the buffer's tile rows, and go on to the next page, as u8g2 */
+uint8_t u8g2_NextPage(u8g2_t *u8g2) {
+  const u8x8_display_info_t *info = u8g2->u8x8.display_info;
+  for (uint8_t r = 0; r < u8g2->tile_buf_height; r++) {
+    if (u8g2->tile_curr_row + r < info->tile_height)
+      u8x8_DrawTile(&u8g2->u8x8, 0, u8g2->tile_curr_row + r, info->tile_width,
+		    u8g2->tile_buf_ptr + r * info->tile_width * 8);
+  }
+  uint8_t row = u8g2->tile_curr_row + u8g2->tile_buf_height;
+  if (row >= info->tile_height) {
+    u8x8_RefreshDisplay(&u8g2->u8x8);
+    return 0;
+  }
+  if (u8g2->is_auto_page_clear)
+    u8g2_ClearBuffer(u8g2);
+  u8g2_SetBufferCurrTileRow(u8g2, row);
+  return 1;
+}
+
+/* set, clear or invert pixel x, y, if it is in the clip window and the buffer's page */
+static void u8g2_pixel(u8g2_t *u8g2, int x, int y, uint8_t color) {
+  uint8_t w = u8g2->u8x8.display_info->tile_width * 8;
+  int py = y - u8g2->tile_curr_row * 8;
+  if (x < u8g2->clip_x0 || x >= u8g2->clip_x1 || x >= w || y < u8g2->clip_y0 || y >= u8g2->clip_y1)
+    return;
+  if (x < 0 || py < 0 || py >= u8g2->tile_buf_height * 8)
+    return;
+  uint8_t *b = u8g2->tile_buf_ptr + (py / 8) * w + x;
+  uint8_t m = 1 << (py & 7);
+  if (color == 0)
+    *b &= ~m;
+  else if (color == 1)
+    *b |= m;
+  else
+    *b ^= m;
+}
+
+void u8g2_DrawBox(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w, u8g2_uint_t h) {
+  for (u8g2_uint_t j = 0; j < h; j++)
+    for (u8g2_uint_t i = 0; i < w; i++)
+      u8g2_pixel(u8g2, x + i, y + j, u8g2->draw_color);
+}
+
+/*
+ * Font decoding, the u8g2 font format: a 23 byte header with the bit
+ * widths of the glyph fields, then for each glyph its encoding, the
+ * offset to the next glyph, and a bit stream, least significant bit
+ * first, of width, height, x and y offset, x advance, and run length
+ * encoded pixels.
+ */
+typedef struct {
+  const uint8_t *p;
+  uint8_t bit;
+} u8g2_bits_t;
+
+static unsigned u8g2_get_bits(u8g2_bits_t *d, uint8_t cnt) {
+  unsigned v = 0;
+  for (uint8_t i = 0; i < cnt; i++) {
+    v |= ((*d->p >> d->bit) & 0x01) << i;
+    if (++d->bit == 8) {
+      d->bit = 0;
+      d->p++;
+    }
+  }
+  return v;
+}
+
+static int u8g2_get_signed_bits(u8g2_bits_t *d, uint8_t cnt) {
+  return (int) u8g2_get_bits(d, cnt) - (1 << (cnt - 1));
+}
+
+typedef struct {
+  uint8_t w, h;
+  int8_t x, y, dx;
+} u8g2_glyph_t;
+
+/* find the glyph, and read its size, leaves d at its pixels, 0 if not in the font */
+static uint8_t u8g2_find_glyph(const uint8_t *font, uint16_t encoding, u8g2_glyph_t *g, u8g2_bits_t *d) {
+  if (font == NULL || encoding > 0xff)
+    return 0;
+  for (const uint8_t *p = font + 23; p[1] != 0; p += p[1]) {
+    if (p[0] != encoding)
+      continue;
+    d->p = p + 2;
+    d->bit = 0;
+    g->w = u8g2_get_bits(d, font[4]);
+    g->h = u8g2_get_bits(d, font[5]);
+    g->x = u8g2_get_signed_bits(d, font[6]);
+    g->y = u8g2_get_signed_bits(d, font[7]);
+    g->dx = u8g2_get_signed_bits(d, font[8]);
+    return 1;
+  }
+  return 0;
+}
+
+int8_t u8g2_GetGlyphWidth(u8g2_t *u8g2, uint16_t encoding) {
+  u8g2_glyph_t g;
+  u8g2_bits_t d;
+  if (!u8g2_find_glyph(u8g2->font, encoding, &g, &d))
+    return 0;
+  u8g2->glyph_width = g.w;
+  u8g2->glyph_x_offset = g.x;
+  return g.dx;
+}
+
+/* as u8g2, the advances, except for the last glyph, its pixel width */
+u8g2_uint_t u8g2_GetStrWidth(u8g2_t *u8g2, const char *s) {
+  u8g2_uint_t w = 0;
+  int8_t dx = 0;
+  u8g2->glyph_width = 0;
+  for (; *s != '\0'; s++) {
+    dx = u8g2_GetGlyphWidth(u8g2, (uint8_t) *s);
+    w += dx;
+  }
+  if (u8g2->glyph_width != 0)
+    w += u8g2->glyph_width + u8g2->glyph_x_offset - dx;
+  return w;
+}
+
+/* draw the glyph with its baseline at x, y, solid as u8g2's default font mode, return its advance */
+static int8_t u8g2_draw_glyph(u8g2_t *u8g2, int x, int y, uint16_t encoding) {
+  const uint8_t *font = u8g2->font;
+  u8g2_glyph_t g;
+  u8g2_bits_t d;
+  if (!u8g2_find_glyph(font, encoding, &g, &d))
+    return 0;
+  if (g.w == 0)
+    return g.dx;
+  int x0 = x + g.x, y0 = y - g.h - g.y;
+  uint8_t px = 0, py = 0;
+  while (py < g.h) {
+    unsigned zeros = u8g2_get_bits(&d, font[2]);
+    unsigned ones = u8g2_get_bits(&d, font[3]);
+    do {
+      for (unsigned i = 0; i < zeros + ones && py < g.h; i++) {
+	u8g2_pixel(u8g2, x0 + px, y0 + py, i < zeros ? !u8g2->draw_color : u8g2->draw_color);
+	if (++px == g.w) {
+	  px = 0;
+	  py++;
+	}
+      }
+    } while (u8g2_get_bits(&d, 1) != 0);
+  }
+  return g.dx;
+}
+
+u8g2_uint_t u8g2_DrawStr(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y, const char *s) {
+  u8g2_uint_t x0 = x;
+  for (; *s != '\0'; s++)
+    x += u8g2_draw_glyph(u8g2, x, y, (uint8_t) *s);
+  return x - x0;
+}
+
+}
@@ -0,0 +1,496 @@
+/*
+ * hp_display - program for Arduino for replacing the display on some
+ * discontinued HP/Agilent/Keysight instruments.
+ * Copyright (C) 2019  Ragnar Sundblad
+ *
+ * This file is part of the hp_display program.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Decode regression test and benchmark, on a Linux host.
+ *
+ * Reads frames from a file, in the format of the examples in
+ * doc/protocol_descr.txt: one big endian hex word per line, '#'
+ * starts a comment, a blank line ends a frame. "@ text" lines are
+ * copied to the output, as titles.
+ *
+ * Each frame is fed twice through the SPI interrupt routine (the
+ * first one after start only gets the sync, and the instrument sends
+ * every frame many times anyway), then decoded with update_disp() and
+ * update_disp_combined(), and the result is printed, one line per
+ * frame. "make check" compares that with golden.txt.
+ *
+ * With -b, the frames are instead replayed repeatedly, and the time
+ * per frame is printed, for the SPI routine (feed) and the decoding.
+ *
+ * With -g, glitches are injected in a stream of each frame, at every
+ * word position: a lost word, a word from another position, and an
+ * extra word. The recovery time, in words (~1 ms each) from the
+ * glitch until the next complete frame is committed, is printed.
+ *
+ * With -l, the first frame is streamed with different faults, and
+ * the time until the link monitor reports it is printed.
+ *
+ * With -k i, frames i and i + 1 are alternated every 300 ms, as a
+ * blinking field, then frame i is kept. The text changes and when
+ * the blinking is detected and ends are printed.
+ *
+ * With -t, built with TFT_ST7735 or TFT_ILI9341 ("make tft"), each
+ * frame is drawn on the TFT panel stand-in in tft_panel.cpp, and the
+ * bytes sent for it are printed, compared with a full screen redraw.
+ * The last frame is saved as tft.ppm.
+ *
+ * With -d, built with LCD_20X4_HD44780 and/or OLED_128X64 ("make
+ * displays"), each frame is drawn on the LCD and the OLED, on the
+ * library stand-ins in displays.cpp and libs/, and the bytes sent to
+ * each are printed, as counted by the stand-ins, and by the display
+ * code itself (lcd_bytes, oled_bytes), in parentheses.
+ *
+ *   hostbench [-b | -g | -l | -k i | -t | -d] [-n loops] frames.txt
+ *
+ * Options from hp_display_config.h can be tried with e.g.
+ * "make DEFS=-DSPI_ISR_RING check".
+ */
+
+#include <time.h>
+#include <unistd.h>
+#include "Arduino.h"
+#include "hp_display_config.h"
+#include "hp_display_spi.h"
+#include "hp_msg_parse.h"
+#include "tft_spi.h"
+#include "lcd_20x4_hd44780.h"
+#include "oled_128x64.h"
+
+#define MAX_FRAMES 256
+
+struct frame {
+  uint32_t words[16];
+  uint8_t n;
+  char title[64];
+};
+
+static frame frames[MAX_FRAMES];
+static int frames_n = 0;
+
+static int read_frames(const char *fname) {
+  FILE *f = fopen(fname, "r");
+  if (f == NULL) {
+    perror(fname);
+    return -1;
+  }
+  char line[256];
+  int lineno = 0;
+  frame *fr = &frames[0];
+  memset(fr, 0, sizeof(*fr));
+  while (fgets(line, sizeof(line), f) != NULL) {
+    lineno++;
+    char *p = line;
+    while (*p == ' ' || *p == '\t')
+      p++;
+    if (*p == '@') {
+      p++;
+      while (*p == ' ')
+	p++;
+      p[strcspn(p, "\r\n")] = '\0';
+      strncpy(fr->title, p, sizeof(fr->title) - 1);
+      continue;
+    }
+    if (*p == '#')
+      continue;
+    if (*p == '\n' || *p == '\r' || *p == '\0') {
+      if (fr->n == 0)
+	continue;
+      if (fr->n != 16)
+	fprintf(stderr, "%s:%d: frame with %d words\n", fname, lineno, fr->n);
+      if (++frames_n == MAX_FRAMES)
+	break;
+      fr = &frames[frames_n];
+      memset(fr, 0, sizeof(*fr));
+      continue;
+    }
+    char *end;
+    unsigned long w = strtoul(p, &end, 16);
+    if (end == p) {
+      fprintf(stderr, "%s:%d: bad line\n", fname, lineno);
+      fclose(f);
+      return -1;
+    }
+    if (fr->n < 16)
+      fr->words[fr->n++] = w;
+  }
+  if (fr->n > 0 && frames_n < MAX_FRAMES)
+    frames_n++;
+  fclose(f);
+  return 0;
+}
+
+static void feed_frame(const frame *fr) {
+  for (uint8_t i = 0; i < fr->n; i++)
+    host_feed_word(fr->words[i]);
+  hp_display_spi_poll(); // with SPI_ISR_RING, and the link monitor
+}
+
+static void print_result(int i) {
+  const frame *fr = &frames[i];
+  if (fr->title[0] != '\0')
+    printf("@ %s\n", fr->title);
+  printf("%3d [%s] [%s] [%s]%s ch=%02x hl=", i, disp_text_combined, disp_units_combined,
+	 disp_labels_combined, disp_gate() ? " Gate" : "", disp_change);
+  for (size_t j = 0; j < disp_text_combined_len; j++)
+    putchar(disp_highlights_combined[j] & DISP_HL_BLINK ? '*' : disp_highlights_combined[j] ? '^' : '.');
+  printf(" value=");
+  print_disp_value();
+}
+
+static double now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void bench(long loops) {
+  // feed only, the snapshot just clears what the SPI routine committed
+  uint32_t frame[16], frame_no;
+  double t0 = now_ns();
+  for (long l = 0; l < loops; l++) {
+    for (int i = 0; i < frames_n; i++) {
+      feed_frame(&frames[i]);
+      hp_display_snapshot(frame, &frame_no);
+    }
+  }
+  double t_feed = now_ns() - t0;
+
+  // feed and decode
+  t0 = now_ns();
+  for (long l = 0; l < loops; l++) {
+    for (int i = 0; i < frames_n; i++) {
+      feed_frame(&frames[i]);
+      update_disp();
+      update_disp_combined();
+    }
+  }
+  double t_all = now_ns() - t0;
+
+  double n = (double) loops * frames_n;
+  double feed = t_feed / n, decode = (t_all - t_feed) / n;
+  printf("frames: %.0f\n", n);
+  printf("feed:   %8.1f ns/frame\n", feed);
+  printf("decode: %8.1f ns/frame (update_disp + update_disp_combined)\n", decode);
+  printf("total:  %8.1f ns/frame, %.0f frames/s\n", t_all / n, 1e9 * n / t_all);
+}
+
+#define GLITCH_DROP 0
+#define GLITCH_WRONG 1
+#define GLITCH_EXTRA 2
+static const char *glitch_names[] = {"lost word", "wrong word", "extra word"};
+
+/* words until a frame is committed after a glitch at word pos in fr */
+static int glitch_recovery(const frame *fr, int kind, int pos) {
+  // get in sync, with some clean frames
+  for (int i = 0; i < 3; i++)
+    feed_frame(fr);
+  uint32_t committed = spi_frames_committed;
+  int words = 0;
+  for (int i = pos; i < 16; i++) {
+    if (i == pos && kind == GLITCH_DROP)
+      continue;
+    if (i == pos && kind == GLITCH_WRONG) {
+      host_feed_word(fr->words[(i + 7) & 0x0f]);
+      continue;
+    }
+    if (i == pos && kind == GLITCH_EXTRA)
+      host_feed_word(fr->words[i]);
+    host_feed_word(fr->words[i]);
+    hp_display_spi_poll();
+    words++;
+    if (spi_frames_committed != committed)
+      return words;
+  }
+  for (int l = 0; l < 10; l++) {
+    for (int i = 0; i < 16; i++) {
+      host_feed_word(fr->words[i]);
+      hp_display_spi_poll();
+      words++;
+      if (spi_frames_committed != committed)
+	return words;
+    }
+  }
+  return -1; // never recovered
+}
+
+static void glitch_test() {
+  printf("recovery after a glitch, in words, until the next complete frame\n");
+  printf("%-12s %6s %4s %6s\n", "glitch", "avg", "max", "failed");
+  for (int kind = 0; kind < 3; kind++) {
+    long sum = 0, n = 0;
+    int max = 0, failed = 0;
+    for (int f = 0; f < frames_n; f++) {
+      for (int pos = 0; pos < 16; pos++) {
+	int words = glitch_recovery(&frames[f], kind, pos);
+	if (words < 0) {
+	  failed++;
+	  continue;
+	}
+	sum += words;
+	n++;
+	if (words > max)
+	  max = words;
+      }
+    }
+    printf("%-12s %6.1f %4d %6d\n", glitch_names[kind], n ? (double) sum / n : 0.0, max, failed);
+  }
+  printf("sync losses: %lu, time to lock: avg %.1f max %u words\n", (unsigned long) spi_sync_loss,
+	 spi_resyncs ? (double) spi_lock_words_sum / spi_resyncs : 0.0, spi_lock_words_max);
+}
+
+#define LINK_CLEAN 0
+#define LINK_SILENT 1 // no words
+#define LINK_STUCK 2  // the same word over and over
+#define LINK_LOSSY 3  // a word lost every 4th frame
+#define LINK_JITTER 4 // word period 826 and 1126 us
+static const char *link_names[] = {"clean", "no words", "stuck word", "lossy", "jitter"};
+static const char *link_state_names[] = {"ok", "degraded", "stalled", "no display"};
+
+/* stream fr with fault kind until link_state is want, return the time in ms, -1 if never */
+static long link_detect(const frame *fr, int kind, uint8_t want) {
+  unsigned long t0 = host_ms;
+  for (int n = 0; n < 2000; n++) {
+    int i = n & 0x0f;
+    host_word_us = 976;
+    if (kind == LINK_SILENT) {
+      host_advance_us(host_word_us);
+    } else if (kind == LINK_STUCK) {
+      host_feed_word(fr->words[1]);
+    } else if (kind == LINK_LOSSY && i == 5 && (n & 0x30) == 0) {
+      host_advance_us(host_word_us);
+    } else {
+      if (kind == LINK_JITTER)
+	host_word_us = (n & 1) ? 826 : 1126;
+      host_feed_word(fr->words[i]);
+    }
+    hp_display_spi_poll();
+    if (link_state == want)
+      return host_ms - t0;
+  }
+  return -1;
+}
+
+static void link_test() {
+  const frame *fr = &frames[0];
+  static const struct { int kind; uint8_t want; } steps[] = {
+    {LINK_CLEAN, LINK_OK}, {LINK_SILENT, LINK_NO_DISPLAY}, {LINK_CLEAN, LINK_OK},
+    {LINK_STUCK, LINK_STALLED}, {LINK_CLEAN, LINK_OK}, {LINK_LOSSY, LINK_DEGRADED},
+    {LINK_CLEAN, LINK_OK}, {LINK_JITTER, LINK_DEGRADED}, {LINK_CLEAN, LINK_OK},
+  };
+  printf("link monitor, time from the change until it is reported\n");
+  printf("%-12s %-12s %6s\n", "stream", "state", "ms");
+  for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+    long ms = link_detect(fr, steps[i].kind, steps[i].want);
+    printf("%-12s %-12s ", link_names[steps[i].kind], link_state_names[steps[i].want]);
+    if (ms < 0)
+      printf("%6s\n", "never");
+    else
+      printf("%6ld\n", ms);
+  }
+}
+
+/* stream fr for ms, decoding every frame, print text changes, return how many */
+static int blink_stream(const frame *fr, unsigned long ms, unsigned long t0) {
+  int changes = 0;
+  for (unsigned long t = host_ms; host_ms - t < ms; ) {
+    for (uint8_t i = 0; i < 16; i++)
+      host_feed_word(fr->words[i]);
+    hp_display_spi_poll();
+    update_disp();
+    update_disp_combined();
+    if (disp_change & (CHANGE_TEXT | CHANGE_BLINK)) {
+      changes++;
+      printf("%5lu ms ", host_ms - t0);
+      print_result(fr - frames);
+    }
+  }
+  return changes;
+}
+
+static void blink_test(int first) {
+  if (first < 0 || first + 1 >= frames_n) {
+    fprintf(stderr, "no frames %d and %d\n", first, first + 1);
+    return;
+  }
+  unsigned long t0 = host_ms;
+  int changes = 0;
+  for (int i = 0; i < 10; i++)
+    changes += blink_stream(&frames[first + (i & 1)], 300, t0);
+  printf("blinking: %d text changes in %d phases, period %u ms\n", changes, 10, disp_blink_period);
+  changes = blink_stream(&frames[first], 1000, t0);
+  printf("steady: %d text changes, blink mask %03x\n", changes, disp_blink);
+}
+
+#ifdef TFT_SPI
+static void tft_test() {
+  const unsigned long full = (unsigned long) TFT_WIDTH * TFT_HEIGHT * 2;
+  tft_spi_setup();
+  printf("panel %dx%d, setup %lu bytes, a full redraw %lu bytes\n", TFT_WIDTH, TFT_HEIGHT, host_tft_bytes, full);
+  unsigned long total = 0;
+  for (int i = 0; i < frames_n; i++) {
+    feed_frame(&frames[i]);
+    feed_frame(&frames[i]);
+    update_disp();
+    update_disp_combined();
+    unsigned long b0 = host_tft_bytes;
+    int steps = 1;
+    tft_spi_update(disp_change);
+    while (tft_spi_step())
+      steps++;
+    unsigned long bytes = host_tft_bytes - b0;
+    total += bytes;
+    printf("%3d %6lu bytes %5.1f%% %2d steps [%s]\n", i, bytes, 100.0 * bytes / full, steps, disp_text_combined);
+  }
+  printf("frames: %d, %.0f bytes/frame, %.1f%% of full redraws, %lu pixels outside the panel\n", frames_n,
+	 (double) total / frames_n, 100.0 * total / full / frames_n, host_tft_outside);
+  host_tft_save_ppm("tft.ppm", TFT_WIDTH, TFT_HEIGHT);
+}
+#endif
+
+#if defined(LCD_20X4_HD44780) || defined(OLED_128X64)
+extern unsigned long host_lcd_bytes;
+extern "C" unsigned long host_oled_bytes;
+
+static void displays_test() {
+#ifdef LCD_20X4_HD44780
+  lcd_20x4_hd44780_setup();
+  while (lcd_20x4_hd44780_step())
+    ;
+#endif
+#ifdef OLED_128X64
+  oled_128x64_setup();
+#endif
+  uint32_t lcd_own = 0, oled_own = 0;
+  printf("%3s %12s %12s\n", "", "lcd bytes", "oled bytes");
+  for (int i = 0; i < frames_n; i++) {
+    feed_frame(&frames[i]);
+    feed_frame(&frames[i]);
+    update_disp();
+    update_disp_combined();
+    unsigned long lcd0 = host_lcd_bytes, oled0 = host_oled_bytes;
+#ifdef LCD_20X4_HD44780
+    lcd_own = lcd_bytes;
+#endif
+#ifdef OLED_128X64
+    oled_own = oled_bytes;
+#endif
+#ifdef LCD_20X4_HD44780
+    lcd_20x4_hd44780_update(disp_change);
+    while (lcd_20x4_hd44780_step())
+      ;
+    lcd_own = lcd_bytes - lcd_own;
+#endif
+#ifdef OLED_128X64
+    oled_128x64_update(disp_change);
+    while (oled_128x64_step())
+      ;
+    oled_own = oled_bytes - oled_own;
+#endif
+    printf("%3d %5lu (%4u) %5lu (%4u) [%s]\n", i, host_lcd_bytes - lcd0, lcd_own, host_oled_bytes - oled0, oled_own,
+	   disp_text_combined);
+  }
+}
+#endif
+
+int main(int argc, char **argv) {
+  int opt, do_bench = 0, do_glitch = 0, do_link = 0, do_tft = 0, do_displays = 0, blink_first = -1;
+  long loops = 100000;
+
+  while ((opt = getopt(argc, argv, "bglk:tdn:")) != -1) {
+    switch (opt) {
+    case 'b':
+      do_bench = 1;
+      break;
+    case 'g':
+      do_glitch = 1;
+      break;
+    case 'l':
+      do_link = 1;
+      break;
+    case 'k':
+      blink_first = atoi(optarg);
+      break;
+    case 't':
+      do_tft = 1;
+      break;
+    case 'd':
+      do_displays = 1;
+      break;
+    case 'n':
+      loops = atol(optarg);
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-b | -g | -l | -k i | -t | -d] [-n loops] frames.txt\n", argv[0]);
+      return 2;
+    }
+  }
+  if (optind >= argc) {
+    fprintf(stderr, "usage: %s [-b | -g | -l | -k i | -t | -d] [-n loops] frames.txt\n", argv[0]);
+    return 2;
+  }
+  if (read_frames(argv[optind]) != 0)
+    return 1;
+
+  if (do_bench) {
+    bench(loops);
+    return 0;
+  }
+  if (do_glitch) {
+    glitch_test();
+    return 0;
+  }
+  if (do_link) {
+    link_test();
+    return 0;
+  }
+  if (do_tft) {
+#ifdef TFT_SPI
+    tft_test();
+    return 0;
+#else
+    fprintf(stderr, "built without TFT_ST7735 or TFT_ILI9341, try \"make tft\"\n");
+    return 2;
+#endif
+  }
+  if (do_displays) {
+#if defined(LCD_20X4_HD44780) || defined(OLED_128X64)
+    displays_test();
+    return 0;
+#else
+    fprintf(stderr, "built without LCD_20X4_HD44780 or OLED_128X64, try \"make displays\"\n");
+    return 2;
+#endif
+  }
+  if (blink_first >= 0) {
+    blink_test(blink_first);
+    return 0;
+  }
+
+  for (int i = 0; i < frames_n; i++) {
+    feed_frame(&frames[i]);
+    feed_frame(&frames[i]);
+    update_disp();
+    update_disp_combined();
+    print_result(i);
+  }
+  return 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * hp_display - program for Arduino for replacing the display on some
+ * discontinued HP/Agilent/Keysight instruments.
+ * Copyright (C) 2019  Ragnar Sundblad
+ *
+ * This file is part of the hp_display program.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Stand-in for the U8g2 C++ classes, just the 128x64 SSD1306 and
+ * SSD1309 ones that oled_128x64.cpp uses, with 1, 2 and 8 tile row
+ * buffers. See displays.cpp.
+ */
+
+#ifndef HOSTBENCH_U8G2LIB_H
+#define HOSTBENCH_U8G2LIB_H
+
+#include "clib/u8g2.h"
+
+class U8G2 {
+protected:
+  u8g2_t u8g2;
+public:
+  U8G2(uint8_t tile_buf_height);
+  u8g2_t *getU8g2() { return &u8g2; }
+  void begin();
+  void setI2CAddress(uint8_t) {}
+  void setFont(const uint8_t *font) { u8g2.font = font; }
+  void setDrawColor(uint8_t color) { u8g2.draw_color = color; }
+  void setClipWindow(u8g2_uint_t x0, u8g2_uint_t y0, u8g2_uint_t x1, u8g2_uint_t y1) {
+    u8g2.clip_x0 = x0;
+    u8g2.clip_y0 = y0;
+    u8g2.clip_x1 = x1;
+    u8g2.clip_y1 = y1;
+  }
+  void setMaxClipWindow() { setClipWindow(0, 0, 0xffff, 0xffff); }
+  u8g2_uint_t getStrWidth(const char *s) { return u8g2_GetStrWidth(&u8g2, s); }
+  u8g2_uint_t drawStr(u8g2_uint_t x, u8g2_uint_t y, const char *s) { return u8g2_DrawStr(&u8g2, x, y, s); }
+  void drawBox(u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w, u8g2_uint_t h) { u8g2_DrawBox(&u8g2, x, y, w, h); }
+  void firstPage() { u8g2_FirstPage(&u8g2); }
+  uint8_t nextPage() { return u8g2_NextPage(&u8g2); }
+  void clearBuffer() { u8g2_ClearBuffer(&u8g2); }
+  uint8_t *getBufferPtr() { return u8g2.tile_buf_ptr; }
+  uint8_t getBufferTileHeight() { return u8g2.tile_buf_height; }
+  uint8_t getBufferTileWidth() { return u8g2.u8x8.display_info->tile_width; }
+};
+
+#define HOSTBENCH_U8G2_CLASS(name, rows)				\
+  class name : public U8G2 {						\
+  public:								\
+    name(const u8g2_cb_t *, uint8_t = U8X8_PIN_NONE, uint8_t = U8X8_PIN_NONE, \
+	 uint8_t = U8X8_PIN_NONE, uint8_t = U8X8_PIN_NONE, uint8_t = U8X8_PIN_NONE) : U8G2(rows) { } \
+  };
+
+HOSTBENCH_U8G2_CLASS(U8G2_SSD1306_128X64_NONAME_1_HW_I2C, 1)
+HOSTBENCH_U8G2_CLASS(U8G2_SSD1306_128X64_NONAME_2_HW_I2C, 2)
+HOSTBENCH_U8G2_CLASS(U8G2_SSD1306_128X64_NONAME_F_HW_I2C, 8)
+HOSTBENCH_U8G2_CLASS(U8G2_SSD1309_128X64_NONAME0_1_4W_SW_SPI, 1)
+HOSTBENCH_U8G2_CLASS(U8G2_SSD1309_128X64_NONAME0_2_4W_SW_SPI, 2)
+HOSTBENCH_U8G2_CLASS(U8G2_SSD1309_128X64_NONAME0_F_4W_SW_SPI, 8)
+
+extern const uint8_t u8g2_font_helvB10_tf[];
+
+#endif // HOSTBENCH_U8G2LIB_H
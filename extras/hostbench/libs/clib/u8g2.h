@@ -0,0 +1,88 @@
+/*
+ * hp_display - program for Arduino for replacing the display on some
+ * discontinued HP/Agilent/Keysight instruments.
+ * Copyright (C) 2019  Ragnar Sundblad
+ *
+ * This file is part of the hp_display program.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Stand-in for the u8g2 C library, just what oled_128x64.cpp uses:
+ * the page buffer, the font decoding for drawing text, and tile
+ * transfers, which are counted instead of sent. See displays.cpp.
+ */
+
+#ifndef HOSTBENCH_U8G2_H
+#define HOSTBENCH_U8G2_H
+
+#include <stdint.h>
+
+#define U8G2_FONT_SECTION(name)
+#define U8X8_PIN_NONE 255
+
+typedef uint16_t u8g2_uint_t;
+
+typedef struct {
+  uint8_t tile_width, tile_height;
+} u8x8_display_info_t;
+
+typedef struct {
+  const u8x8_display_info_t *display_info;
+} u8x8_t;
+
+typedef struct {
+  uint8_t dummy;
+} u8g2_cb_t;
+
+typedef struct {
+  u8x8_t u8x8;
+  uint8_t *tile_buf_ptr;
+  uint8_t tile_buf_height;     // tile rows in the buffer, 1, 2 or 8
+  uint8_t tile_curr_row;       // display tile row of the buffer's first row
+  uint8_t is_auto_page_clear;
+  const uint8_t *font;
+  uint8_t draw_color;          // 0 clear, 1 set, 2 xor
+  u8g2_uint_t clip_x0, clip_y0, clip_x1, clip_y1; // exclusive ends
+  uint8_t glyph_width;         // of the last glyph looked up, as u8g2
+  int8_t glyph_x_offset;
+} u8g2_t;
+
+#define u8g2_GetU8x8(u8g2) (&(u8g2)->u8x8)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern const u8g2_cb_t u8g2_cb_r0;
+#define U8G2_R0 (&u8g2_cb_r0)
+
+void u8g2_FirstPage(u8g2_t *u8g2);
+uint8_t u8g2_NextPage(u8g2_t *u8g2);
+void u8g2_SetBufferCurrTileRow(u8g2_t *u8g2, uint8_t row);
+void u8g2_ClearBuffer(u8g2_t *u8g2);
+uint8_t *u8g2_GetBufferPtr(u8g2_t *u8g2);
+int8_t u8g2_GetGlyphWidth(u8g2_t *u8g2, uint16_t encoding);
+u8g2_uint_t u8g2_GetStrWidth(u8g2_t *u8g2, const char *s);
+u8g2_uint_t u8g2_DrawStr(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y, const char *s);
+void u8g2_DrawBox(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w, u8g2_uint_t h);
+void u8x8_DrawTile(u8x8_t *u8x8, uint8_t x, uint8_t y, uint8_t cnt, uint8_t *tile_ptr);
+void u8x8_RefreshDisplay(u8x8_t *u8x8);
+
+extern unsigned long host_oled_bytes; // display data bytes sent, with u8x8_DrawTile()
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOSTBENCH_U8G2_H
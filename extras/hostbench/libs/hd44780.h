@@ -0,0 +1,44 @@
+/*
+ * hp_display - program for Arduino for replacing the display on some
+ * discontinued HP/Agilent/Keysight instruments.
+ * Copyright (C) 2019  Ragnar Sundblad
+ *
+ * This file is part of the hp_display program.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Stand-in for the hd44780 library, just what lcd_20x4_hd44780.cpp
+ * uses. The bytes written are counted instead of sent, and the
+ * busy flag always says ready. See displays.cpp.
+ */
+
+#ifndef HOSTBENCH_HD44780_H
+#define HOSTBENCH_HD44780_H
+
+#include <Arduino.h>
+
+extern unsigned long host_lcd_bytes; // command and data bytes written
+
+class hd44780 {
+public:
+  int begin(uint8_t cols, uint8_t rows);
+  int status() { return 0; } // R/W wired, not busy
+  void setExecTimes(uint32_t, uint32_t) {}
+  void setCursor(uint8_t col, uint8_t row) { host_lcd_bytes++; } // a set DDRAM address command
+  size_t write(uint8_t c) { host_lcd_bytes++; return 1; }
+};
+
+#endif // HOSTBENCH_HD44780_H
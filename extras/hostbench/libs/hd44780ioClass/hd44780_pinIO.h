@@ -0,0 +1,34 @@
+/*
+ * hp_display - program for Arduino for replacing the display on some
+ * discontinued HP/Agilent/Keysight instruments.
+ * Copyright (C) 2019  Ragnar Sundblad
+ *
+ * This file is part of the hp_display program.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Stand-in for the hd44780 library's pin i/o class, see displays.cpp */
+
+#ifndef HOSTBENCH_HD44780_PINIO_H
+#define HOSTBENCH_HD44780_PINIO_H
+
+#include <hd44780.h>
+
+class hd44780_pinIO : public hd44780 {
+public:
+  hd44780_pinIO(int rs, int rw, int en, int d4, int d5, int d6, int d7) {}
+};
+
+#endif // HOSTBENCH_HD44780_PINIO_H
@@ -0,0 +1,121 @@
+#!/bin/python
+
+from __future__ import division, absolute_import, print_function
+import os, sys, argparse
+
+#
+# hp_display - program for Arduino for replacing the display on some
+# discontinued HP/Agilent/Keysight instruments.
+# Copyright (C) 2019  Ragnar Sundblad
+#
+# This file is part of the hp_display program.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+
+#
+# Make a 53131A frame, in the frames.txt format, from a display text,
+# for adding test cases. Separators follow the character they belong
+# to, as on the display:
+#
+#   mkframe.py -u MHz -l Freq,Ch1 -g " 10.000,000,12"
+#
+
+# do not write bytecode (.pyc) files
+sys.dont_write_bytecode=True
+
+LABELS = ["Period", "Freq", "+Wid", "-Wid", "Rise", "Fall", "Time", "Ch1",
+          "Ch2", "Ch3", "Limit", "ExtRef"]
+SEPS = {".": 0x2, ":": 0x3, ",": 0x6, ";": 0x7}
+FRAME_SEQ = [8, 0, 9, 1, 10, 2, 11, 3, "x3", 4, "x2", 5, "x1", 6, "x0", 7]
+
+
+def read_codes():
+    codes = {}
+    fname = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "codes-mapped.list")
+    for line in open(fname):
+        code, char = line.split(None, 1)
+        char = char.strip()[1:-1]
+        if char not in codes:
+            codes[char] = int(code, 16)
+    return codes
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Make a 53131A SPI frame from a text")
+    parser.add_argument("text", help="display text, with separators")
+    parser.add_argument("-u", "--units", default="", help="M, Hz, u, s combination, e.g. MHz")
+    parser.add_argument("-l", "--labels", default="", help="comma separated labels")
+    parser.add_argument("-g", "--gate", action="store_true", help="Gate on")
+    parser.add_argument("-H", "--highlight", default="", help="positions to highlight, 0 is rightmost, e.g. 0,1,2")
+    parser.add_argument("-t", "--title", default=None, help="@ title line")
+    args = parser.parse_args()
+
+    codes = read_codes()
+    chars = []
+    seps = []
+    for c in args.text:
+        if c in SEPS and chars:
+            seps[-1] = SEPS[c]
+        else:
+            chars.append(c)
+            seps.append(0)
+    if len(chars) > 12:
+        sys.exit("text too long")
+    chars = [" "] * (12 - len(chars)) + chars
+    seps = [0] * (12 - len(seps)) + seps
+    chars.reverse() # position 0 rightmost
+    seps.reverse()
+
+    words = {}
+    for pos in range(12):
+        w = (0x00100000 << pos) | codes[chars[pos]] | (seps[pos] << 16)
+        words[pos] = w
+    u = args.units
+    if u.startswith("M"):
+        words[0] |= 0x100
+        u = u[1:]
+    if u.startswith("u"):
+        words[0] |= 0x10000
+        u = u[1:]
+    if u.startswith("Hz"):
+        words[0] |= 0x200
+        u = u[2:]
+    if u.startswith("s"):
+        words[0] |= 0x20000
+        u = u[1:]
+    if u:
+        sys.exit("unknown units")
+    if args.gate:
+        words[0] |= 0x40000
+    for l in filter(None, args.labels.split(",")):
+        words[11 - LABELS.index(l)] |= 0x80000
+    hl = [int(p) for p in filter(None, args.highlight.split(","))]
+    for x in range(4):
+        if x < len(hl):
+            pos = hl[x]
+            words["x%d" % (2 - x if x < 3 else 3)] = (0x00100000 << pos) | codes[chars[pos]]
+    for x in range(4):
+        words.setdefault("x%d" % x, 0x80000000)
+
+    if args.title:
+        print("@ " + args.title)
+    for i in FRAME_SEQ:
+        w = words[i]
+        print("%8X # %s" % (w, ("char %d \"%s\"" % (i, chars[i])) if isinstance(i, int) else i))
+    print()
+
+
+if __name__ == "__main__":
+    main()
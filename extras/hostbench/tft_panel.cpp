@@ -0,0 +1,115 @@
+/*
+ * hp_display - program for Arduino for replacing the display on some
+ * discontinued HP/Agilent/Keysight instruments.
+ * Copyright (C) 2019  Ragnar Sundblad
+ *
+ * This file is part of the hp_display program.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Stand-in for an ST7735 or ILI9341 TFT panel, for measuring what
+ * tft_spi.cpp sends without one: interprets the window (CASET,
+ * RASET) and pixel (RAMWR) commands into a frame buffer, counts the
+ * bytes and pixels, and can save the frame buffer as a PPM image.
+ */
+
+#include "Arduino.h"
+
+#define PANEL_W 320 // the largest supported panel
+#define PANEL_H 240
+
+#define TFT_CASET 0x2a
+#define TFT_RASET 0x2b
+#define TFT_RAMWR 0x2c
+
+static uint16_t fb[PANEL_H][PANEL_W];
+static uint8_t cmd = 0;
+static uint8_t args[4], args_n = 0;
+static uint16_t win_x0, win_x1, win_y0, win_y1, x, y;
+static uint8_t pixel_hi, pixel_n = 0;
+
+extern "C" {
+unsigned long host_tft_bytes = 0;   // all bytes, commands and data
+unsigned long host_tft_pixels = 0;  // pixels written
+unsigned long host_tft_outside = 0; // pixels written outside the panel, a bug
+
+void host_tft_write(uint8_t dc, uint8_t b) {
+  host_tft_bytes++;
+  if (!dc) {
+    cmd = b;
+    args_n = 0;
+    pixel_n = 0;
+    if (cmd == TFT_RAMWR) {
+      x = win_x0;
+      y = win_y0;
+    }
+    return;
+  }
+  if (cmd == TFT_CASET || cmd == TFT_RASET) {
+    if (args_n < 4)
+      args[args_n++] = b;
+    if (args_n == 4) {
+      uint16_t a = args[0] << 8 | args[1], e = args[2] << 8 | args[3];
+      if (cmd == TFT_CASET) {
+	win_x0 = a;
+	win_x1 = e;
+      } else {
+	win_y0 = a;
+	win_y1 = e;
+      }
+    }
+    return;
+  }
+  if (cmd != TFT_RAMWR)
+    return;
+  if (pixel_n == 0) {
+    pixel_hi = b;
+    pixel_n = 1;
+    return;
+  }
+  pixel_n = 0;
+  host_tft_pixels++;
+  if (x < PANEL_W && y < PANEL_H)
+    fb[y][x] = pixel_hi << 8 | b;
+  else
+    host_tft_outside++;
+  if (x++ == win_x1) {
+    x = win_x0;
+    if (y++ == win_y1)
+      y = win_y0;
+  }
+}
+
+/* save the top left w x h pixels as a binary PPM */
+int host_tft_save_ppm(const char *fname, uint16_t w, uint16_t h) {
+  FILE *f = fopen(fname, "wb");
+  if (f == NULL) {
+    perror(fname);
+    return -1;
+  }
+  fprintf(f, "P6\n%u %u\n255\n", w, h);
+  for (uint16_t py = 0; py < h && py < PANEL_H; py++) {
+    for (uint16_t px = 0; px < w && px < PANEL_W; px++) {
+      uint16_t c = fb[py][px];
+      fputc((c >> 11) << 3, f);
+      fputc(((c >> 5) & 0x3f) << 2, f);
+      fputc((c & 0x1f) << 3, f);
+    }
+  }
+  fclose(f);
+  return 0;
+}
+}
@@ -0,0 +1,250 @@
+#!/bin/python
+
+from __future__ import division, absolute_import, print_function
+import os, sys, argparse, struct
+
+#
+# hp_display - program for Arduino for replacing the display on some
+# discontinued HP/Agilent/Keysight instruments.
+# Copyright (C) 2019  Ragnar Sundblad
+#
+# This file is part of the hp_display program.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+
+#
+# Decode the binary telemetry from hp_telemetry.cpp (HP_TELEMETRY,
+# "bin" command) into one line per frame, and the raw capture
+# (SPI_RAW_CAPTURE, "raw" command) into one line per SPI word: time in
+# us (unwrapped from the 4 us ticks), gate number and the word as in
+# doc/protocol_descr.txt.
+#
+# Reads from a serial port (needs pyserial) or from a file, or stdin,
+# with a capture. Records are COBS encoded and ended with a 0 byte,
+# anything else on the line, like the command echo, fails the CRC and
+# is skipped.
+#
+
+# do not write bytecode (.pyc) files
+sys.dont_write_bytecode=True
+
+TELE_REC_DISPLAY = 0x01
+TELE_REC_RAW = 0x02
+TELE_REC_RAW_REPEAT = 0x03
+TELE_REC_RAW_LOST = 0x04
+
+TELE_TEXT = 0x01
+TELE_SEPS = 0x02
+TELE_HIGHLIGHTS = 0x04
+TELE_LABELS = 0x08
+TELE_UNITS = 0x10
+TELE_BLINK = 0x20
+TELE_ALL = 0x3f
+
+SEP_CHARS = ".:,;"
+
+# as in hp_msg_parse.cpp
+PROFILES = {
+    "53131a": (["Period", "Freq", "+Wid", "-Wid", "Rise", "Fall", "Time", "Ch1",
+                "Ch2", "Ch3", "Limit", "ExtRef"],
+               ["M", "Hz", "u", "s", "Gate"]),
+    "34401a": (["*", "Adrs", "Rmt", "Man", "Trig", "Hold", "Mem", "Ratio",
+                "Math", "ERROR", "Rear", "Shift"],
+               ["4", "W", "[Cont]", "[???]", "[Diode]"]),
+}
+PROFILES["58503b"] = PROFILES["53131a"]
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data) + 1:
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xff and i < len(data):
+            out.append(0)
+    return out
+
+
+def crc16(data):
+    crc = 0xffff
+    for b in data:
+        crc ^= b << 8
+        for i in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xffff
+    return crc
+
+
+class Display(object):
+    def __init__(self, profile):
+        self.labels_text, self.units_text = PROFILES[profile]
+        self.text = bytearray(b" " * 12)
+        self.seps = 0
+        self.sep_kinds = 0
+        self.highlights = 0
+        self.labels = 0
+        self.units_gate = 0
+        self.blink = 0
+        self.blink_period = 0
+        self.synced = False # got all fields at least once
+
+    def update(self, fields, data):
+        i = 0
+        if fields & TELE_TEXT:
+            self.text = data[i:i + 12]
+            i += 12
+        if fields & TELE_SEPS:
+            self.seps, self.sep_kinds = struct.unpack_from("<HI", data, i)
+            i += 6
+        if fields & TELE_HIGHLIGHTS:
+            self.highlights, = struct.unpack_from("<H", data, i)
+            i += 2
+        if fields & TELE_LABELS:
+            self.labels, = struct.unpack_from("<H", data, i)
+            i += 2
+        if fields & TELE_UNITS:
+            self.units_gate = data[i]
+            i += 1
+        if fields & TELE_BLINK:
+            self.blink, self.blink_period = struct.unpack_from("<HH", data, i)
+            i += 4
+        if fields == TELE_ALL:
+            self.synced = True
+        return i == len(data)
+
+    # same as update_disp_combined()
+    def combined(self):
+        text = ""
+        hl = ""
+        for i in range(11, -1, -1):
+            text += chr(self.text[i])
+            hl += "*" if (self.blink >> i) & 1 else "^" if (self.highlights >> i) & 1 else " "
+            if (self.seps >> i) & 1:
+                text += SEP_CHARS[(self.sep_kinds >> (2 * i)) & 3]
+                hl += " "
+        units = "".join(self.units_text[i] for i in range(4) if (self.units_gate >> i) & 1)
+        labels = " ".join(self.labels_text[11 - i] for i in range(11, -1, -1) if (self.labels >> i) & 1)
+        gate = self.units_text[4] if (self.units_gate >> 4) & 1 else ""
+        return text, hl.rstrip(), units, labels, gate
+
+
+def records(f):
+    buf = bytearray()
+    while True:
+        data = f.read(1)
+        if not data:
+            return
+        b = bytearray(data)[0]
+        if b != 0:
+            buf.append(b)
+            continue
+        rec = cobs_decode(buf)
+        buf = bytearray()
+        if rec is None or len(rec) < 3:
+            continue
+        if crc16(rec[:-2]) != struct.unpack_from("<H", rec, len(rec) - 2)[0]:
+            continue
+        yield rec[:-2]
+
+
+class Raw(object):
+    def __init__(self):
+        self.last_tick = None
+        self.t_us = 0
+
+    # ticks wrap every 262 ms, fine between words, but not over repeats
+    def time(self, tick):
+        if self.last_tick is not None:
+            self.t_us += ((tick - self.last_tick) & 0xffff) * 4
+        self.last_tick = tick
+        return self.t_us
+
+    def words(self, rec):
+        ms, n = struct.unpack_from("<IB", rec, 1)
+        for i in range(n):
+            tick, gate = struct.unpack_from("<HB", rec, 6 + i * 7)
+            word, = struct.unpack_from(">I", rec, 9 + i * 7)
+            print("%12d %2d %08x" % (self.time(tick), gate, word))
+
+    def repeat(self, rec):
+        ms, count, tick = struct.unpack_from("<IHH", rec, 1)
+        # only the first tick of the last repeated group is known, take
+        # the time from millis() - less exact
+        self.t_us = ms * 1000
+        self.last_tick = tick
+        print("%12s last %d frames repeated, until %d ms" % ("", count, ms))
+
+    def lost(self, rec):
+        ms, overflows, incom = struct.unpack_from("<III", rec, 1)
+        print("%12s words lost: %d ring overflows, %d incomplete in total, at %d ms" %
+              ("", overflows, incom, ms))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode hp_display binary telemetry")
+    parser.add_argument("input", nargs="?", help="serial port or capture file, default stdin")
+    parser.add_argument("-b", "--baud", type=int, default=115200, help="serial port speed")
+    parser.add_argument("-m", "--model", default="53131a", choices=sorted(PROFILES.keys()))
+    parser.add_argument("-a", "--all", action="store_true", help="also print frames without changes")
+    args = parser.parse_args()
+
+    if args.input is None:
+        f = getattr(sys.stdin, "buffer", sys.stdin)
+    elif args.input.startswith("/dev/") or args.input.startswith("COM"):
+        import serial
+        f = serial.Serial(args.input, args.baud)
+        f.write(b"bin\r") # note: toggles, if already on it's turned off
+    else:
+        f = open(args.input, "rb")
+
+    disp = Display(args.model)
+    raw = Raw()
+    last_frame = None
+    for rec in records(f):
+        if rec[0] == TELE_REC_RAW:
+            raw.words(rec)
+            continue
+        if rec[0] == TELE_REC_RAW_REPEAT:
+            raw.repeat(rec)
+            continue
+        if rec[0] == TELE_REC_RAW_LOST:
+            raw.lost(rec)
+            continue
+        if rec[0] != TELE_REC_DISPLAY:
+            continue
+        frame, ms, fields = struct.unpack_from("<IIB", rec, 1)
+        if not disp.update(fields, rec[10:]):
+            print("bad record length", file=sys.stderr)
+            continue
+        lost = 0 if last_frame is None else frame - last_frame - 1
+        last_frame = frame
+        if not disp.synced or (fields == 0 and not args.all):
+            continue
+        text, hl, units, labels, gate = disp.combined()
+        print("%10d %10d %s %-4s %s%s%s%s" % (frame, ms, text, units, labels,
+                                              "  " + gate if gate else "",
+                                              "  (blink %d ms)" % disp.blink_period if disp.blink else "",
+                                              "  (%d frames without record)" % lost if lost > 0 else ""))
+        if hl:
+            print("%21s %s" % ("", hl))
+        sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,114 @@
+/*
+ * hp_display - program for Arduino for replacing the display on some
+ * discontinued HP/Agilent/Keysight instruments.
+ * Copyright (C) 2019  Ragnar Sundblad
+ * 
+ * This file is part of the hp_display program.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Update coalescing and rate limiting for the display sinks.
+ *
+ * The instrument sends 64 frames per second, and a fast changing
+ * reading changes most of them. Redrawing the HD44780 or the I2C OLED
+ * for each of them takes longer than a frame, delaying loop(). Each
+ * sink instead has a max refresh rate, min_interval_ms, and a hold
+ * time, hold_ms, that a new text is shown at least. Changes that come
+ * in between are merged into the pending CHANGE_* bits, so nothing is
+ * lost, just drawn later, with the decoder's latest strings.
+ *
+ * A sink with a step function draws an update over several loop()s,
+ * a bounded piece each time, and gets no new update until it is done.
+ * A sink only gets the CHANGE_* bits it consumes, so a change it does
+ * not draw neither wakes it up nor counts as coalesced.
+ */
+
+#include <Arduino.h>
+#include "hp_display_config.h" // include this before the other local files
+
+#include "hp_msg_parse.h"
+#include "hp_disp_sink.h"
+#include "oled_128x64.h"
+#include "lcd_20x4_hd44780.h"
+#include "tft_spi.h"
+
+struct lcd_sink : disp_sink_none {
+#ifdef LCD_20X4_HD44780
+  static const char *name() { return "lcd"; }
+  static constexpr uint16_t consumes = CHANGE_TEXT_COMB | CHANGE_UNITS_COMB | CHANGE_LABELS_COMB | CHANGE_GATE;
+  static constexpr uint16_t hold_on = CHANGE_TEXT_COMB;
+  static constexpr uint16_t min_interval_ms = LCD_MIN_INTERVAL_MS;
+  static constexpr uint16_t hold_ms = LCD_HOLD_MS;
+  static void setup() { lcd_20x4_hd44780_setup(); }
+  static void update(uint16_t change) { lcd_20x4_hd44780_update(change); }
+  static void blink() { lcd_20x4_hd44780_blink(); }
+  static uint8_t step() { return lcd_20x4_hd44780_step(); }
+  static uint32_t bytes() { return lcd_bytes; }
+  static void print() { lcd_20x4_hd44780_print(); }
+#endif
+};
+
+struct oled_sink : disp_sink_none {
+#ifdef OLED_128X64
+  static const char *name() { return "oled"; }
+#ifdef OLED_SHOW_STATS
+  static constexpr uint16_t consumes = CHANGE_TEXT | CHANGE_UNITS | CHANGE_LABELS | CHANGE_GATE | CHANGE_VALUE;
+#else
+  static constexpr uint16_t consumes = CHANGE_TEXT | CHANGE_UNITS | CHANGE_LABELS | CHANGE_GATE;
+#endif
+  static constexpr uint16_t hold_on = CHANGE_TEXT;
+  static constexpr uint16_t min_interval_ms = OLED_MIN_INTERVAL_MS;
+  static constexpr uint16_t hold_ms = OLED_HOLD_MS;
+  static void setup() { oled_128x64_setup(); }
+  static void update(uint16_t change) { oled_128x64_update(change); }
+  static void blink() { oled_128x64_blink(); }
+  static uint8_t step() { return oled_128x64_step(); }
+  static uint32_t bytes() { return oled_bytes; }
+  static void print() { oled_128x64_print(); }
+#endif
+};
+
+struct tft_sink : disp_sink_none {
+#ifdef TFT_SPI
+  static const char *name() { return "tft"; }
+  static constexpr uint16_t consumes = CHANGE_TEXT | CHANGE_UNITS | CHANGE_LABELS | CHANGE_GATE;
+  static constexpr uint16_t hold_on = CHANGE_TEXT;
+  static constexpr uint16_t min_interval_ms = TFT_MIN_INTERVAL_MS;
+  static constexpr uint16_t hold_ms = TFT_HOLD_MS;
+  static void setup() { tft_spi_setup(); }
+  static void update(uint16_t change) { tft_spi_update(change); }
+  static void blink() { tft_spi_blink(); }
+  static uint8_t step() { return tft_spi_step(); }
+  static uint32_t bytes() { return tft_bytes; }
+  static void print() { tft_spi_print(); }
+#endif
+};
+
+/* the sinks, in the order they are updated */
+typedef disp_sink_pipeline<lcd_sink, oled_sink, tft_sink> disp_sinks;
+
+void disp_sinks_setup() {
+  disp_sinks::setup();
+}
+
+/* merge change into the sinks' pending bits and update those that may, call every loop() */
+void disp_sinks_update(uint16_t change) {
+  disp_sinks::update(change, millis());
+}
+
+void disp_sinks_print() {
+  disp_sinks::print();
+}
@@ -0,0 +1,169 @@
+/*
+ * hp_display - program for Arduino for replacing the display on some
+ * discontinued HP/Agilent/Keysight instruments.
+ * Copyright (C) 2019  Ragnar Sundblad
+ * 
+ * This file is part of the hp_display program.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Display sinks, the LCD, the OLED and the TFT, updated at their own
+ * pace, see hp_disp_sink.cpp.
+ *
+ * A sink is a struct with only static members, like the instrument
+ * profiles in hp_profiles.h, listed in disp_sinks in hp_disp_sink.cpp.
+ * The pipeline below is instantiated for that list, so each sink's
+ * functions are called directly, with no function pointers, and a
+ * sink that is not enabled compiles to nothing. Adding a display is
+ * adding its struct to the list, loop() and setup() stay the same.
+ *
+ * The members, disp_sink_none has the defaults:
+ *   name()           - for the "sinks" printout
+ *   consumes         - the CHANGE_* bits it draws, 0 when not enabled
+ *   hold_on          - the CHANGE_* bits that are a new text, see hold_ms
+ *   min_interval_ms  - shortest time between updates, the max refresh rate
+ *   hold_ms          - shortest time a new text is shown
+ *   setup()
+ *   update(change)   - redraw what change, CHANGE_* bits, says
+ *   blink()          - toggle blinking characters, called when nothing is pending
+ *   step()           - continue an update, returns nonzero while busy
+ *   bytes()          - bytes sent to the display, 0 if not counted
+ *   print()          - print sink specific information
+ */
+
+#ifndef HP_DISP_SINK_H
+#define HP_DISP_SINK_H
+
+struct disp_sink_none {
+  static const char *name() { return "none"; }
+  static constexpr uint16_t consumes = 0;
+  static constexpr uint16_t hold_on = 0;
+  static constexpr uint16_t min_interval_ms = 0;
+  static constexpr uint16_t hold_ms = 0;
+  static void setup() { }
+  static void update(uint16_t change) { }
+  static void blink() { }
+  static uint8_t step() { return 0; }
+  static uint32_t bytes() { return 0; }
+  static void print() { }
+};
+
+/* the run time state of a sink */
+typedef struct {
+  uint16_t pending;      // CHANGE_* bits not yet drawn
+  uint8_t held;          // the last update drew text, wait hold_ms
+  unsigned long last_t;  // millis() of the last update
+  uint32_t updates;      // updates done
+  uint32_t coalesced;    // changes merged into an already pending update
+  uint32_t skipped;      // texts replaced before they were drawn
+} disp_sink_state_t;
+
+template <class S>
+struct disp_sink_run {
+  static disp_sink_state_t st;
+
+  static void update(uint16_t change, unsigned long now) {
+    change &= S::consumes; // only what the sink draws
+    if (change) {
+      if (st.pending) {
+        st.coalesced++;
+        if (change & st.pending & S::hold_on)
+          st.skipped++;
+      }
+      st.pending |= change;
+    }
+    if (S::step())
+      return; // still drawing, what changed meanwhile is drawn next
+    if (st.pending) {
+      uint16_t wait = S::min_interval_ms;
+      if (st.held && S::hold_ms > wait)
+        wait = S::hold_ms;
+      if (now - st.last_t < wait)
+        return;
+      S::update(st.pending);
+      st.held = (st.pending & S::hold_on) ? 1 : 0;
+      st.pending = 0;
+      st.last_t = now;
+      st.updates++;
+    } else {
+      S::blink(); // only when the shown text is the latest
+    }
+  }
+
+  static void print() {
+    Serial.print(S::name());
+    Serial.print(F(": max "));
+    Serial.print(1000 / (S::min_interval_ms ? S::min_interval_ms : 1));
+    Serial.print(F("/s, hold "));
+    Serial.print(S::hold_ms);
+    Serial.print(F(" ms, updates: "));
+    Serial.print(st.updates);
+    Serial.print(F(", coalesced: "));
+    Serial.print(st.coalesced);
+    Serial.print(F(", skipped: "));
+    Serial.print(st.skipped);
+    Serial.print(F(", pending: "));
+    Serial.println(st.pending, 16);
+    uint32_t bytes = S::bytes();
+    if (bytes != 0) {
+      Serial.print(F("  bytes sent: "));
+      Serial.print(bytes);
+      Serial.print(F(", per update: "));
+      Serial.println(st.updates ? bytes / st.updates : 0);
+    }
+    S::print();
+  }
+};
+
+template <class S>
+disp_sink_state_t disp_sink_run<S>::st;
+
+template <class... S>
+struct disp_sink_pipeline;
+
+template <>
+struct disp_sink_pipeline<> {
+  static void setup() { }
+  static void update(uint16_t change, unsigned long now) { }
+  static void print() { }
+};
+
+template <class S, class... R>
+struct disp_sink_pipeline<S, R...> {
+  static void setup() {
+    if (S::consumes)
+      S::setup();
+    disp_sink_pipeline<R...>::setup();
+  }
+  static void update(uint16_t change, unsigned long now) {
+    if (S::consumes)
+      disp_sink_run<S>::update(change, now);
+    disp_sink_pipeline<R...>::update(change, now);
+  }
+  static void print() {
+    if (S::consumes)
+      disp_sink_run<S>::print();
+    disp_sink_pipeline<R...>::print();
+  }
+};
+
+void disp_sinks_setup();
+/* merge change into the sinks' pending bits and update those that may, call every loop() */
+void disp_sinks_update(uint16_t change);
+void disp_sinks_print();
+
+#endif // HP_DISP_SINK_H
@@ -25,6 +25,9 @@
 #include "hp_msg_parse.h"
 #include "oled_128x64.h"
 #include "lcd_20x4_hd44780.h"
+#include "hp_stats.h"
+#include "hp_telemetry.h"
+#include "hp_disp_sink.h"
 
 
 uint8_t debug = 0;
@@ -39,6 +42,9 @@ uint32_t loops_n = 0;
 uint32_t loops_n_last = 0;
 uint32_t updates_n = 0;
 uint32_t updates_n_last = 0;
+unsigned long loop_us = 0;     // micros() when the last loop() began
+uint32_t loop_us_max = 0;      // longest loop() this second
+uint32_t loop_us_max_last = 0; // and the last second
 
 // ###############
 // Setup
@@ -49,13 +55,7 @@ void setup() {
   setup_pins();
   setup_hp_display_spi();
 
-  #ifdef LCD_20X4_HD44780
-  lcd_20x4_hd44780_setup();
-  #endif
-
-  #ifdef OLED_128X64
-  oled_128x64_setup();
-  #endif
+  disp_sinks_setup();
 }
 
 // ###############
@@ -63,42 +63,70 @@ void setup() {
 
 void loop() {
   static uint8_t last_spi_frames = 0;
+  static uint8_t last_no_display = 0;
   static uint8_t updates_to_print = 0;
   unsigned long now_ms = millis();
   uint8_t do_print = 0;
 
+  // worst case loop latency, time between the starts of two loop()s
+  unsigned long now_us = micros();
+  if (now_us - loop_us > loop_us_max)
+    loop_us_max = now_us - loop_us;
+  loop_us = now_us;
+
   // cap how often we print, needed on MCU:s without built in USB
   if ((last_print_t + console_print_interval_ms) < now_ms) {
     do_print = do_print_in_loop;
     last_print_t = now_ms;
   }
+  #ifdef HP_TELEMETRY
+  if (tele_on)
+    do_print = 0; // the console is busy with binary records
+  #endif
 
 
 
   if (true) {
+    // handle received SPI words, if not done in the interrupt routine
+    hp_display_spi_poll();
+    #ifdef SPI_ISR_STATS
+    hp_display_spi_stats_update();
+    #endif
+
     // parse commands
     command_parser();
 
-    if ((last_spi_frames != spi_frames) || hp_display_spi_timeout()) { // is there a complete new frame?
+    uint16_t change = 0;
+    uint8_t new_frame = last_spi_frames != spi_frames;
+    uint8_t no_display = hp_display_spi_timeout();
+    if (new_frame || no_display) { // is there a complete new frame?
       last_spi_frames = spi_frames;
 
       // update displays
       update_disp();
       update_disp_combined();
 
-      updates_to_print = 1;
-
-      #ifdef LCD_20X4_HD44780
-      lcd_20x4_hd44780_update();
+      #ifdef HP_STATS
+      if (stats_frame())
+        change |= CHANGE_VALUE; // new statistics to show, also for an unchanged value
       #endif
 
-      #ifdef OLED_128X64
-      oled_128x64_update();
+      #ifdef HP_TELEMETRY
+      // a record per frame, and one when the display is lost, not one per loop() without frames
+      if (new_frame || !last_no_display)
+        tele_send_frame();
       #endif
 
+      updates_to_print = 1;
+
+      change |= disp_change;
       if (disp_change)
         updates_n++;
     }
+    last_no_display = no_display;
+
+    // update the displays, at their own pace, and blink what the instrument blinks
+    disp_sinks_update(change);
 
     if (do_print && updates_to_print) {
       Serial.println("############");
@@ -147,6 +175,8 @@ void loop() {
           loops_n = 0;
           updates_n_last = updates_n;
           updates_n = 0;
+          loop_us_max_last = loop_us_max;
+          loop_us_max = 0;
           loops_t = m_now;
         }
         loops_n++;
@@ -155,6 +185,9 @@ void loop() {
           Serial.println(loops_n_last);
           Serial.print(F("updates/s: "));
           Serial.println(updates_n_last);
+          Serial.print(F("longest loop: "));
+          Serial.print(loop_us_max_last);
+          Serial.println(F(" us"));
         }
       }
     }
@@ -171,12 +204,12 @@ void print_display_fields() {
 
   for(uint8_t i = 0; i < 12; i++) {
     text[11-i] = disp_text[i];
-    seps[11-i] = disp_separators[i] ? disp_separators[i] : '_';
-    highlights[11-i] = disp_highlights[i] ? 'x' : '_';
-    labels[11-i] = disp_labels[i] ? 'x' : '_';
+    seps[11-i] = disp_separator(i) ? disp_separator(i) : '_';
+    highlights[11-i] = disp_highlight(i) ? 'x' : '_';
+    labels[11-i] = disp_label(i) ? 'x' : '_';
   }
   for(uint8_t i = 0; i < 5; i++) {
-    units_gate[i] = disp_units_gate[i] ? 'x' : '_';
+    units_gate[i] = disp_unit_gate(i) ? 'x' : '_';
   }
   text[12] = seps[12] = labels[12] = units_gate[5] = '\0';
   Serial.print((const char*) text);
@@ -197,7 +230,7 @@ void print_display_combined() {
   Serial.println(disp_units_combined);
 
   Serial.print(disp_labels_combined);
-  if(disp_units_gate[4] != 0) { // Gate
+  if(disp_gate()) {
     Serial.print("    ");
     Serial.print(hp_display_units_gate[4]);
   }
@@ -276,6 +309,34 @@ void handle_command() {
     cmd_debug();
   } else if (match_command("lps")) {
     cmd_lps();
+  } else if (match_command("link")) {
+    hp_display_link_print();
+  } else if (match_command("sinks")) {
+    disp_sinks_print();
+  } else if (match_command("value")) {
+    cmd_value();
+#ifdef SPI_ISR_STATS
+  } else if (match_command("isr")) {
+    hp_display_spi_stats_print();
+  } else if (match_command("isrreset")) {
+    hp_display_spi_stats_reset();
+    Serial.println(F("interrupt statistics reset."));
+#endif
+#ifdef HP_STATS
+  } else if (match_command("stats")) {
+    stats_print();
+  } else if (match_command("statsreset")) {
+    stats_reset();
+    Serial.println(F("statistics reset."));
+#endif
+#ifdef HP_TELEMETRY
+  } else if (match_command("bin")) {
+    cmd_bin();
+#endif
+#ifdef SPI_RAW_CAPTURE
+  } else if (match_command("raw")) {
+    cmd_raw();
+#endif
   } else {
     Serial.print(F("unknown command: "));
     Serial.println(cmdbuf);
@@ -299,7 +360,24 @@ void cmd_help() {
   Serial.println(F("continue         - continue printout (without waiting for timeout)"));
   Serial.println(F("unk              - print accumulated unknown characters"));
   Serial.println(F("debug            - toggle debug printouts"));
-  Serial.println(F("lps              - toggle loops per second printouts"));
+  Serial.println(F("lps              - toggle loops per second and longest loop printouts"));
+  Serial.println(F("link             - print the SPI link state and frame rate"));
+  Serial.println(F("sinks            - print the display update counters"));
+  Serial.println(F("value            - print the displayed value as a number"));
+#ifdef SPI_ISR_STATS
+  Serial.println(F("isr              - print SPI interrupt statistics"));
+  Serial.println(F("isrreset         - reset SPI interrupt statistics"));
+#endif
+#ifdef HP_STATS
+  Serial.println(F("stats            - print statistics of the readings"));
+  Serial.println(F("statsreset       - restart the statistics"));
+#endif
+#ifdef HP_TELEMETRY
+  Serial.println(F("bin              - toggle binary telemetry output"));
+#endif
+#ifdef SPI_RAW_CAPTURE
+  Serial.println(F("raw              - toggle raw SPI word capture output"));
+#endif
   Serial.println("");
 }
 
@@ -312,6 +390,8 @@ void cmd_u() {
   print_unknown_seg14s();
   Serial.println(F("########### Unknowns separators seen:"));
   print_unknown_separator();
+  Serial.print(F("Frame now: "));
+  Serial.println(disp_frame_no);
 }
 
 void cmd_debug() {
@@ -326,12 +406,49 @@ void cmd_debug() {
 void cmd_lps() {
   debug_loopsps = ~debug_loopsps;
   if (debug_loopsps) {
+    loop_us_max = 0; // not counted while off
     Serial.println(F("loops per second printout turned on."));
   } else {
     Serial.println(F("loops per second printout turned off."));
   }
 }
 
+void cmd_value() {
+  Serial.print(disp_text_combined);
+  Serial.print(F(" "));
+  Serial.print(disp_units_combined);
+  Serial.print(F(" -> "));
+  print_disp_value();
+}
+
+#ifdef HP_TELEMETRY
+void cmd_bin() {
+  if (tele_on) {
+    tele_enable(TELE_OFF);
+    Serial.print(F("binary telemetry turned off, records sent: "));
+    Serial.print(tele_records);
+    Serial.print(F(", skipped: "));
+    Serial.println(tele_skipped);
+  } else {
+    Serial.println(F("binary telemetry turned on."));
+    tele_enable(TELE_DISPLAY);
+  }
+}
+#endif
+
+#ifdef SPI_RAW_CAPTURE
+void cmd_raw() {
+  if (tele_on) {
+    tele_enable(TELE_OFF);
+    Serial.print(F("raw capture turned off, words captured: "));
+    Serial.println(tele_raw_words);
+  } else {
+    Serial.println(F("raw capture turned on."));
+    tele_enable(TELE_RAW);
+  }
+}
+#endif
+
 // ###############
 // Setup stuff
 
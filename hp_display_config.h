@@ -36,6 +36,13 @@
  */
 //#define ARDUINO_NANO
 
+/*
+ * Instrument model, selects how the display is decoded, see
+ * hp_profiles.h. Default is HP 53131A/53132A/53181A.
+ */
+//#define HP_58503B
+//#define HP_34401A // NOT TESTED!
+
 /*
  * *** Enable/disable optional software components
  */
@@ -51,9 +58,108 @@
 /* OLED, 128x64 SSD1309 pixel graphical display, SPI (in software) */
 //#define OLED_128X64_SSD1309_SW_SPI
 
+/*
+ * OLED drawing buffer, tile rows of 8 pixels: 1 (128 bytes RAM), 2 (256
+ * bytes) or 8, a full frame buffer (2 KB with the copy of what the
+ * display shows, too much for the ATmega328P and ATmega32U4), that
+ * sends only the 8x8 pixel tiles that changed.
+ */
+//#define OLED_PAGE_BUFFER 1
+
+/*
+ * Color TFT, SPI (in software, on the same pins as the SSD1309 OLED),
+ * ST7735 160x128 or ILI9341 320x240, drawn as a 14 segment display.
+ */
+//#define TFT_ST7735
+//#define TFT_ILI9341
+
+/*
+ * Display refresh limits, in ms: each display is updated at most every
+ * *_MIN_INTERVAL_MS, default 50, and a new reading is kept for at
+ * least *_HOLD_MS, default 100, before the next one is shown. See
+ * hp_disp_sink.cpp.
+ */
+//#define LCD_MIN_INTERVAL_MS 50
+//#define LCD_HOLD_MS 100
+//#define OLED_MIN_INTERVAL_MS 50
+//#define OLED_HOLD_MS 100
+//#define TFT_MIN_INTERVAL_MS 50
+//#define TFT_HOLD_MS 100
+
+/*
+ * Characters written to the LCD per loop(), each when its busy flag
+ * says it is ready. Default 4.
+ */
+//#define LCD_DRAIN_BYTES 4
+
 
 /* Other options */
 
+/*
+ * Histograms of the SPI interrupt routine's poll loops, run time and
+ * the time between words, and incomplete words and sync losses per
+ * second, printed with the "isr" command.
+ */
+//#define SPI_ISR_STATS
+
+/*
+ * Running mean, standard deviation and Allan deviation of the
+ * displayed readings, on the console with the "stats" command.
+ * OLED_SHOW_STATS also shows the standard deviation on the OLED, to
+ * the left of the units.
+ */
+//#define HP_STATS
+//#define OLED_SHOW_STATS
+
+/*
+ * A reading is counted when the Gate annunciator goes off, at the next
+ * value change or, for a reading equal to the last, STATS_SETTLE_MS
+ * (default 100) later. Without the Gate going off for
+ * STATS_GATE_TIMEOUT_MS (default 3000), each value change counts.
+ */
+//#define STATS_SETTLE_MS 100
+//#define STATS_GATE_TIMEOUT_MS 3000
+
+/*
+ * Binary telemetry: the "bin" command switches the console from text
+ * printouts to one compact binary record per frame, with only the
+ * changed fields. Decode with extras/telemetry_decode.py.
+ */
+//#define HP_TELEMETRY
+
+/*
+ * Raw capture: the "raw" command streams every SPI word, with a time
+ * stamp and gate number, as binary records, for diagnosing an
+ * instrument. Runs of identical frames are collapsed. Needs (and
+ * turns on) SPI_ISR_RING and HP_TELEMETRY.
+ */
+//#define SPI_RAW_CAPTURE
+
+/*
+ * Make the SPI interrupt routine only collect the 4 bytes and put the
+ * word in a ring buffer. Gate decoding and frame sync tracking is then
+ * done from loop(), keeping the time with interrupts disabled as
+ * short as possible. Needs loop() to run at least every SPI_RING_LEN
+ * (default 32) ms, or words are lost (counted in spi_ring_overflows).
+ */
+//#define SPI_ISR_RING
+
+/*
+ * Time without SPI words before "(NO DISPLAY)" is shown, and without
+ * complete frames before the link is reported as stalled. Default 50
+ * ms, about three frames; raise it if the instrument pauses its
+ * display updates.
+ */
+//#define LINK_TIMEOUT_MS 1000
+
+/*
+ * The link is reported as degraded when more than LINK_DROPS_MAX
+ * (default 2) of the last 16 frames were dropped, or the average word
+ * period deviation is over LINK_JITTER_MAX (default 25, 100 us).
+ */
+//#define LINK_DROPS_MAX 2
+//#define LINK_JITTER_MAX 25
+
 /* 
  * Hack for Arduino Pro Micro with ATmega32U4, probably also useful on
  * Leonardo: Disable pin 17, RX-LED, which we want to use as SPI /SS
@@ -94,4 +200,31 @@
  #endif
 #endif
 
+/* The TFT controllers use the same code, TFT_SPI */
+#if defined(TFT_ST7735) || defined(TFT_ILI9341)
+ #ifndef TFT_SPI
+  #define TFT_SPI
+ #endif
+ #ifdef OLED_128X64
+  #error "The TFT uses the OLED's pins, choose one of them"
+ #endif
+#endif
+
+/* The SPI_RAW_CAPTURE is done in the SPI_ISR_RING drain, with the HP_TELEMETRY framing */
+#ifdef SPI_RAW_CAPTURE
+ #ifndef SPI_ISR_RING
+  #define SPI_ISR_RING
+ #endif
+ #ifndef HP_TELEMETRY
+  #define HP_TELEMETRY
+ #endif
+#endif
+
+/* The OLED_SHOW_STATS needs the statistics */
+#ifdef OLED_SHOW_STATS
+ #ifndef HP_STATS
+  #define HP_STATS
+ #endif
+#endif
+
 #endif // HP_DISPLAY_CONFIG_H
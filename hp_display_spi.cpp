@@ -69,6 +69,8 @@
 #include "hp_display_config.h" // include this before the other local files
 
 #include "hp_display_spi.h"
+#include "hp_profiles.h"
+#include "hp_telemetry.h"
 
 //#define SPIDEBUG
 
@@ -94,6 +96,11 @@
 // last value for each character position - initiate with "---" which will be displayed until we get data
 uint32_t spi_msgs[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0x03000020, 0x03000040, 0x03000080, 0, 0, 0, 0 };
 uint8_t spi_frames = 0; // incremented when we have got a complete new frame
+uint16_t spi_msgs_dirty = 0xffff; // bit per spi_msgs[] entry that changed since last snapshot, all initially
+uint8_t spi_frame_pending = 0; // a committed frame has not yet been taken by hp_display_snapshot()
+uint32_t spi_frames_committed = 0; // complete, in sync, frames copied to spi_msgs[]
+uint32_t spi_frames_dropped = 0; // incomplete frames thrown away because of sync loss
+uint32_t spi_frames_overwritten = 0; // committed frames replaced before a snapshot was taken
 unsigned long spi_msg_last_t = 0; // time of last received spi msg
 
 /* internal variables, also exported for debugging inspection */
@@ -104,6 +111,71 @@ uint32_t last_spi_msg = 0; // debug
 uint32_t spi_msgs_incom = 0;
 uint32_t spi_msgs_ok = 0;
 uint32_t spi_sync_loss = 0;
+// the frame being received, only words that differ from spi_msgs[] are stored
+uint32_t spi_frame_work[16];
+uint16_t spi_frame_work_dirty = 0;
+uint8_t spi_frame_work_n = 0; // words received in sync in this frame
+uint16_t spi_msg_last_tick = 0; // spi_tick() of last received spi msg
+uint32_t spi_resyncs = 0; // times sync was found again after a loss
+uint32_t spi_lock_words_sum = 0; // words from sync loss to lock, summed over spi_resyncs
+uint8_t spi_lock_words_max = 0;
+uint16_t spi_lock_ticks_max = 0; // longest time from sync loss to lock, in spi_tick()s
+uint8_t spi_lock_words = 0; // words since the sync was lost
+uint16_t spi_lock_t0 = 0; // spi_tick() when the sync was lost
+uint16_t spi_jitter16 = 0; // average deviation from SPI_WORD_TICKS, times 16
+uint8_t spi_jitter_max = 0; // largest deviation since the link monitor last took it
+uint16_t spi_frame_hist = 0xffff; // bit per frame, last in bit 0, 1 if committed, 0 if dropped
+/* link monitor, see spi_link_update() */
+uint8_t link_state = LINK_OK;
+unsigned long link_state_t = 0; // millis() when link_state was entered
+uint32_t link_entered[LINK_STATES]; // times each state was entered
+uint8_t link_fps = 0; // frames committed the last second
+uint16_t link_wps = 0; // words received the last second
+uint8_t link_sync = 16; // of the last 16 frames, how many were committed
+uint8_t link_jitter = 0; // average word period deviation, spi_tick()s
+uint8_t link_jitter_max = 0; // largest deviation the last second
+static unsigned long link_frame_t = 0; // millis() when a new committed frame was last seen
+static uint32_t link_last_committed = 0;
+static unsigned long link_second_t = 0;
+static uint32_t link_second_committed = 0; // totals when the second started
+static uint32_t link_second_words = 0;
+#ifdef SPI_ISR_RING
+#ifndef SPI_RING_LEN
+#define SPI_RING_LEN 32 // must be a power of 2
+#endif
+struct spi_ring_entry {
+  uint32_t msg;
+  uint16_t t; // spi_tick() when received
+};
+spi_ring_entry spi_ring[SPI_RING_LEN];
+volatile uint8_t spi_ring_head = 0; // next entry to write, only written by the ISR
+volatile uint8_t spi_ring_tail = 0; // next entry to read, only written by hp_display_spi_poll()
+uint32_t spi_ring_overflows = 0;
+// keeps the compiler from moving the non volatile spi_ring[] accesses
+// across the spi_ring_head and spi_ring_tail accesses
+#define spi_ring_barrier() asm volatile("" ::: "memory")
+#endif
+#ifdef SPI_ISR_STATS
+// histograms, SPI_HIST_LEN buckets, the last one also counts everything above
+uint16_t spi_hist_loops[SPI_HIST_LEN];     // poll loop iterations per word, 8 per bucket
+uint16_t spi_hist_isr_ticks[SPI_HIST_LEN]; // interrupt routine time, timer 0 ticks (4 us) per bucket
+uint16_t spi_hist_spacing[SPI_HIST_LEN];   // time between complete words, 32 ticks (128 us) per bucket
+uint16_t spi_isr_last_t = 0; // spi_tick() of the last complete word
+// incomplete words and sync losses per second, for the last SPI_RATE_WINDOW seconds
+uint16_t spi_rate_incom[SPI_RATE_WINDOW];
+uint16_t spi_rate_sync_loss[SPI_RATE_WINDOW];
+uint8_t spi_rate_i = 0; // the last second filled in
+unsigned long spi_rate_t = 0; // millis() when the current second started
+uint32_t spi_rate_last_incom = 0; // totals when the current second started
+uint32_t spi_rate_last_sync_loss = 0;
+
+inline void spi_hist_add(uint16_t *hist, uint16_t bucket) {
+  if (bucket >= SPI_HIST_LEN)
+    bucket = SPI_HIST_LEN - 1;
+  if (hist[bucket] != 0xffff)
+    hist[bucket]++;
+}
+#endif
 #ifdef SPIDEBUG
 uint8_t last_spi_msgs_i = 0; // last_spi_msgs_i points to the last written entry
 uint32_t last_spi_msgs[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
@@ -155,20 +227,9 @@ void setup_hp_display_spi() {
 }
 
 
-// returns true if we have not got any SPI data the last seconds
+// returns true if we have not got any SPI data for LINK_TIMEOUT_MS
 uint8_t hp_display_spi_timeout() {
-  uint8_t ret = 0;
-  unsigned long now = millis();
-  noInterrupts();
-  unsigned long last = spi_msg_last_t;
-  interrupts();
-  uint8_t new_no_disp = 0;
-  if (last > now)
-    last = now; // millis() has wrapped
-  if (spi_msg_last_t + 1000 < now)
-    ret = 1;
-  
-  return ret;
+  return link_state == LINK_NO_DISPLAY;
 }
 
 
@@ -247,59 +308,119 @@ uint8_t hp_display_spi_msg2gateno(uint8_t *spi_msg) {
 }
 
 
+/*
+ * Cheap time stamp for the SPI words, in timer 0 ticks (4 us with a
+ * 16 MHz clock), wraps every 262 ms. Same as micros() does, but
+ * without the multiplication. Call with interrupts disabled.
+ */
+extern volatile unsigned long timer0_overflow_count; // in Arduino wiring.c
+inline uint16_t spi_tick() {
+  uint8_t t = TCNT0;
+  uint8_t m = timer0_overflow_count;
+  if ((TIFR0 & _BV(TOV0)) && (t < 255))
+    m++; // overflow not yet handled
+  return (((uint16_t) m) << 8) | t;
+}
+
+
 /* The gate/character-position sequence in a complete frame. */
 /* The 12-15 are the highlighting fields, and can be any gate/charpos */
 /* Index 16 (points to gate 255) is special and means unsynced. */
 uint8_t spi_frame_seq[17] = {8, 0, 9, 1, 10, 2, 11, 3, 12, 4, 13, 5, 14, 6, 15, 7, 255};
 #define SPI_FRAME_SYNC_LOST 16
 uint8_t spi_frame_sync_i = SPI_FRAME_SYNC_LOST;
+uint8_t spi_gate_hist[2] = {255, 255}; // gate numbers of the two previous words, [1] the last
 
+/* true if gate can be at position i in spi_frame_seq */
+inline uint8_t spi_frame_seq_fits(uint8_t i, uint8_t gate) {
+  uint8_t s = spi_frame_seq[i];
+  return s == gate || s > 11; // the highlight fields can have any gate
+}
 
-#ifdef USE_ENABLE_INTERRUPT
-void spi_ss_pin_interrupt() {
-  uint8_t c;
-
-  uint8_t sreg = SREG;
-  cli(); // disable interrupts
+/*
+ * Find the position in spi_frame_seq of the last of three words with
+ * gates g2, g1, g0, in that order. Every character gate is only once
+ * in the sequence, but the highlight fields can have any, so this
+ * returns SPI_FRAME_SYNC_LOST if they fit more than one place (or
+ * none). Only used while out of sync.
+ */
+inline uint8_t spi_frame_seq_find(uint8_t g2, uint8_t g1, uint8_t g0) {
+  uint8_t found = SPI_FRAME_SYNC_LOST;
+  for (uint8_t i = 0; i < 16; i++) {
+    if (spi_frame_seq_fits(i, g0) && spi_frame_seq_fits((i - 1) & 0x0f, g1) &&
+	spi_frame_seq_fits((i - 2) & 0x0f, g2)) {
+      if (found != SPI_FRAME_SYNC_LOST)
+	return SPI_FRAME_SYNC_LOST; // ambiguous
+      found = i;
+    }
+  }
+  return found;
+}
 
-  spi_n_bytes = 0;
-#else
-// SPI interrupt routine
-// Read all 4 bytes polled, with interrupts disabled.
-// (Reading all 4 bytes with one interrupt per byte often fails.)
-// Entire SPI transaction is about 40 us, or ~640 clock cycles @ 16 MHz
-ISR (SPI_STC_vect)
-{
-  uint8_t c = SPDR; // read byte ASAP, in case next one is imminent
-  
-  uint8_t sreg = SREG;
-  cli(); // disable interrupts
 
-  spi_n_bytes = 1;
-  spi_bytes[0] = c;
-#endif
-  uint8_t i = 0;
-  for (; i < 100; i++) {
-    asm volatile("nop"); // sometimes needed to make things actually happen???
-    if (SPSR & _BV(SPIF)) { // got next byte
-      spi_bytes[spi_n_bytes] = SPDR; // fetch the byte
-      spi_n_bytes++;
-    }
-    if (spi_n_bytes > 3) {
-      break;
+/*
+ * Copy the received frame to spi_msgs[], called when all 16 words of
+ * a frame have been received in sync. Only the changed
+ * words are copied.
+ */
+inline void spi_frame_commit() {
+  uint16_t dirty = spi_frame_work_dirty;
+  for (uint8_t i = 0; dirty != 0; i++, dirty >>= 1) {
+    if (dirty & 0x01) {
+      spi_msgs[i] = spi_frame_work[i];
     }
   }
-  spi_ivr_loops = i;
+  spi_msgs_dirty |= spi_frame_work_dirty;
+  if (spi_frame_pending) {
+    spi_frames_overwritten++; // previous frame was never looked at
+  }
+  spi_frame_pending = 1;
+  spi_frame_hist = (spi_frame_hist << 1) | 1;
+  spi_frames_committed++;
+  spi_frames++;
+}
 
-  if (spi_n_bytes < 4) {
-    spi_msgs_incom++;
-    SREG = sreg;
-    return;
+
+/*
+ * Copy the changed words of the last committed frame to frame[16],
+ * which must hold the previous snapshot, and return the mask of
+ * changed words. frame_no is set to the number of the frame (counted
+ * in spi_frames_committed). All in one short critical section, so we
+ * never get a mix of two frames.
+ */
+uint16_t hp_display_snapshot(uint32_t *frame, uint32_t *frame_no) {
+  noInterrupts();
+  *frame_no = spi_frames_committed;
+  uint16_t dirty = spi_msgs_dirty;
+  uint16_t d = dirty;
+  for (uint8_t i = 0; d != 0; i++, d >>= 1) {
+    if (d & 0x01) {
+      frame[i] = spi_msgs[i];
+    }
   }
+  spi_msgs_dirty = 0;
+  spi_frame_pending = 0;
+  interrupts();
+  return dirty;
+}
 
-  // whe have a complete word
-  uint32_t msg = *((uint32_t *) spi_bytes);
-  spi_msgs_ok++;
+
+/*
+ * Handle a complete SPI word: find the character position, maintain
+ * the frame sync, and commit the frame when it is complete. Called
+ * from the interrupt routine, or with SPI_ISR_RING from loop() via
+ * hp_display_spi_poll().
+ */
+inline void spi_handle_msg(uint32_t msg, uint16_t t) {
+  // word period jitter, not across pauses or lost words
+  uint16_t dt = t - spi_msg_last_tick;
+  spi_msg_last_tick = t;
+  if (dt < 2 * SPI_WORD_TICKS) {
+    uint8_t dev = dt > SPI_WORD_TICKS ? dt - SPI_WORD_TICKS : SPI_WORD_TICKS - dt;
+    spi_jitter16 += dev - (spi_jitter16 >> 4);
+    if (dev > spi_jitter_max)
+      spi_jitter_max = dev;
+  }
 
 #ifdef SPIDEBUG
   // store last 16 messages in a cyclic buffer
@@ -309,7 +430,8 @@ ISR (SPI_STC_vect)
 #endif
 
   // find character position based on drived gate number (12 first bits)
-  uint8_t addr = hp_display_spi_msg2gateno(spi_bytes);
+  uint8_t addr = hp_display_spi_msg2gateno((uint8_t *) &msg);
+  uint8_t gate = addr;
 
 #if 1
   // maintain the sync information to handle the 4 extra highlight fields
@@ -323,21 +445,42 @@ ISR (SPI_STC_vect)
       addr = expected_seqn;
       spi_frame_sync_i = (spi_frame_sync_i + 1) & 0x0f;
     } else {
-      // lost sync, wait for gate 10 (which is seldom highlighted and should be a good indicator)
+      // lost sync, lock again as soon as the last three gates fit only one place in the frame
       digitalWrite(SS_OUT_PIN, HIGH); // try toggling /SS
       digitalWrite(SS_OUT_PIN, LOW);
       if (spi_frame_sync_i != SPI_FRAME_SYNC_LOST) {
         spi_frame_sync_i = SPI_FRAME_SYNC_LOST; // indicate sync loss
         spi_sync_loss++;
+        spi_lock_words = 0;
+        spi_lock_t0 = t;
+        if (spi_frame_work_n > 0) {
+          spi_frames_dropped++; // throw away what we got of this frame
+          spi_frame_hist <<= 1;
+          spi_frame_work_n = 0;
+          spi_frame_work_dirty = 0;
+        }
 #ifdef SPIDEBUG
 	hp_display_copy_last_spi_msgs(last_sync_lost_msgs); // save last 16 msgs
 #endif
       }
-      if (addr == 10) { // start of frame
-        spi_frame_sync_i = 5; // set to gate expected next
+      if (spi_lock_words < 255)
+        spi_lock_words++;
+      uint8_t i = spi_frame_seq_find(spi_gate_hist[0], spi_gate_hist[1], gate);
+      if (i != SPI_FRAME_SYNC_LOST) {
+        addr = spi_frame_seq[i]; // this word's place in the frame
+        spi_frame_sync_i = (i + 1) & 0x0f;
+        spi_resyncs++;
+        spi_lock_words_sum += spi_lock_words;
+        if (spi_lock_words > spi_lock_words_max)
+          spi_lock_words_max = spi_lock_words;
+        uint16_t lock_ticks = t - spi_lock_t0;
+        if (lock_ticks > spi_lock_ticks_max)
+          spi_lock_ticks_max = lock_ticks;
       }
     }
   }
+  spi_gate_hist[0] = spi_gate_hist[1];
+  spi_gate_hist[1] = gate;
 #else
   /* debug - just put msgs in buffers in rotating manner */
   spi_frame_sync_i = (spi_frame_sync_i + 1) & 0x0f;
@@ -349,23 +492,208 @@ ISR (SPI_STC_vect)
     addr = addr;
   }
 
-  // if we have sync, update output information
+  // if we have sync, collect the word, and commit the frame when it is complete
   if (spi_frame_sync_i != SPI_FRAME_SYNC_LOST) {
-    spi_msgs[addr] = msg;
+    if (spi_msgs[addr] != msg) {
+      spi_frame_work[addr] = msg;
+      spi_frame_work_dirty |= ((uint16_t) 1) << addr;
+    }
+    spi_frame_work_n++;
     last_spi_msg = msg;
-    if (spi_frame_sync_i == 1) { // we have a complete frame
-      spi_frames++;
+    if (spi_frame_sync_i == 0) { // wrapped, we got the last word of the frame
+      if (spi_frame_work_n == 16) {
+        spi_frame_commit();
+      } else {
+        spi_frames_dropped++; // first frame after sync, incomplete
+        spi_frame_hist <<= 1;
+      }
+      spi_frame_work_n = 0;
+      spi_frame_work_dirty = 0;
+    }
+  }
+}
+
+
+#ifdef USE_ENABLE_INTERRUPT
+void spi_ss_pin_interrupt() {
+  uint8_t c;
+#ifdef SPI_ISR_STATS
+  uint8_t isr_t0 = TCNT0;
+#endif
+
+  uint8_t sreg = SREG;
+  cli(); // disable interrupts
+
+  spi_n_bytes = 0;
+#else
+// SPI interrupt routine
+// Read all 4 bytes polled, with interrupts disabled.
+// (Reading all 4 bytes with one interrupt per byte often fails.)
+// Entire SPI transaction is about 40 us, or ~640 clock cycles @ 16 MHz
+ISR (SPI_STC_vect)
+{
+  uint8_t c = SPDR; // read byte ASAP, in case next one is imminent
+#ifdef SPI_ISR_STATS
+  uint8_t isr_t0 = TCNT0;
+#endif
+  
+  uint8_t sreg = SREG;
+  cli(); // disable interrupts
+
+  spi_n_bytes = 1;
+  spi_bytes[0] = c;
+#endif
+  uint8_t i = 0;
+  for (; i < 100; i++) {
+    asm volatile("nop"); // sometimes needed to make things actually happen???
+    if (SPSR & _BV(SPIF)) { // got next byte
+      spi_bytes[spi_n_bytes] = SPDR; // fetch the byte
+      spi_n_bytes++;
+    }
+    if (spi_n_bytes >= hp_profile::word_bytes) {
+      break;
     }
-  } else {
-    spi_frames++; // increment, to show that it glitched by mkaing it appear on screen - good idea? // XXX
+  }
+  spi_ivr_loops = i;
+
+  if (spi_n_bytes < hp_profile::word_bytes) {
+    spi_msgs_incom++;
+#ifdef SPI_ISR_STATS
+    spi_hist_add(spi_hist_loops, i >> 3);
+    spi_hist_add(spi_hist_isr_ticks, (uint8_t) (TCNT0 - isr_t0));
+#endif
+    SREG = sreg;
+    return;
   }
 
+  // whe have a complete word
+  uint32_t msg = *((uint32_t *) spi_bytes);
+  spi_msgs_ok++;
+#ifdef SPI_ISR_STATS
+  {
+    uint16_t t = spi_tick();
+    if (spi_msgs_ok > 1)
+      spi_hist_add(spi_hist_spacing, (uint16_t) (t - spi_isr_last_t) >> 5);
+    spi_isr_last_t = t;
+  }
+#endif
+
+#ifdef SPI_ISR_RING
+  // just queue the word, the rest is done by hp_display_spi_poll()
+  uint8_t head = spi_ring_head;
+  uint8_t next = (head + 1) & (SPI_RING_LEN - 1);
+  if (next == spi_ring_tail) {
+    spi_ring_overflows++; // full, loop() has not kept up
+  } else {
+    spi_ring[head].msg = msg;
+    spi_ring[head].t = spi_tick();
+    spi_ring_barrier(); // the entry is written before it is published
+    spi_ring_head = next;
+  }
+#else
+  spi_handle_msg(msg, spi_tick());
   spi_msg_last_t = millis();
+#endif
 
+#ifdef SPI_ISR_STATS
+  spi_hist_add(spi_hist_loops, i >> 3);
+  spi_hist_add(spi_hist_isr_ticks, (uint8_t) (TCNT0 - isr_t0));
+#endif
   SREG = sreg; // reenable interrupts
 }
 
 
+/*
+ * Link monitor, replacing the fixed one second timeout. The
+ * instrument sends a word every ~976 us, a frame every ~16 ms, so
+ * the state is known within a few frame periods:
+ *
+ *   LINK_NO_DISPLAY - no words for LINK_TIMEOUT_MS, shown as "(NO DISPLAY)"
+ *   LINK_STALLED    - words, but no complete frame for LINK_TIMEOUT_MS,
+ *                     the instrument is hung or sending garbage
+ *   LINK_DEGRADED   - more than LINK_DROPS_MAX of the last 16 frames
+ *                     were dropped, or the average word period jitter
+ *                     is over LINK_JITTER_MAX. A sync loss now and then
+ *                     is normal, see the README, and is not reported.
+ *   LINK_OK
+ */
+static void spi_link_update() {
+  noInterrupts();
+  unsigned long last_t = spi_msg_last_t;
+  uint32_t committed = spi_frames_committed;
+  uint32_t words = spi_msgs_ok;
+  uint16_t hist = spi_frame_hist;
+  uint8_t jitter = spi_jitter16 >> 4;
+  interrupts();
+  unsigned long now = millis(); // after, so never before last_t
+
+  if (committed != link_last_committed) {
+    link_last_committed = committed;
+    link_frame_t = now;
+  }
+  uint8_t sync = 0;
+  for (; hist != 0; hist &= hist - 1)
+    sync++;
+  link_sync = sync;
+  link_jitter = jitter;
+
+  uint8_t state = LINK_OK;
+  if (now - last_t > LINK_TIMEOUT_MS)
+    state = LINK_NO_DISPLAY;
+  else if (now - link_frame_t > LINK_TIMEOUT_MS)
+    state = LINK_STALLED;
+  else if (16 - sync > LINK_DROPS_MAX || jitter > LINK_JITTER_MAX)
+    state = LINK_DEGRADED;
+  if (state != link_state) {
+    link_state = state;
+    link_state_t = now;
+    link_entered[state]++;
+  }
+
+  if (now - link_second_t >= 1000) {
+    link_second_t = now;
+    uint32_t d = committed - link_second_committed;
+    link_fps = d > 255 ? 255 : d;
+    d = words - link_second_words;
+    link_wps = d > 0xffff ? 0xffff : d;
+    link_second_committed = committed;
+    link_second_words = words;
+    noInterrupts();
+    link_jitter_max = spi_jitter_max;
+    spi_jitter_max = 0;
+    interrupts();
+  }
+}
+
+
+/*
+ * Drain the words queued by the interrupt routine, in SPI_ISR_RING
+ * mode, and update the link monitor. Should be called often from
+ * loop(), the ring holds SPI_RING_LEN words, which is SPI_RING_LEN ms.
+ */
+void hp_display_spi_poll() {
+#ifdef SPI_ISR_RING
+  uint8_t tail = spi_ring_tail;
+  if (tail != spi_ring_head) {
+    do {
+      spi_ring_barrier(); // the entry is read after spi_ring_head
+#ifdef SPI_RAW_CAPTURE
+      if (tele_on == TELE_RAW)
+	tele_raw_word(spi_ring[tail].msg, spi_ring[tail].t,
+		      hp_display_spi_msg2gateno((uint8_t *) &spi_ring[tail].msg));
+#endif
+      spi_handle_msg(spi_ring[tail].msg, spi_ring[tail].t);
+      tail = (tail + 1) & (SPI_RING_LEN - 1);
+      spi_ring_barrier(); // and before it is given back
+      spi_ring_tail = tail; // give the entry back to the ISR
+    } while (tail != spi_ring_head);
+    spi_msg_last_t = millis();
+  }
+#endif
+  spi_link_update();
+}
+
+
 // read last 32 bit value from SPI; 0 = no value; 0xFFFFFFFF = had a short read
 uint32_t hp_display_spi_read() {
   noInterrupts();
@@ -385,8 +713,141 @@ void hp_display_spi_print_debug() {
   PRINTVAR(F("spi_msgs_ok:     "), spi_msgs_ok)
   PRINTVAR(F("spi_msgs_incom:  "), spi_msgs_incom)
   PRINTVAR(F("spi_ivr_loops:   "), spi_ivr_loops)
+#ifdef SPI_ISR_RING
+  PRINTVAR(F("spi_ring_overflows:     "), spi_ring_overflows)
+#endif
+  PRINTVAR(F("spi_frames_committed:   "), spi_frames_committed)
+  PRINTVAR(F("spi_frames_dropped:     "), spi_frames_dropped)
+  PRINTVAR(F("spi_frames_overwritten: "), spi_frames_overwritten)
+  PRINTVAR(F("spi_resyncs:            "), spi_resyncs)
+  PRINTVAR(F("spi_lock_words_sum:     "), spi_lock_words_sum)
+  PRINTVAR(F("spi_lock_words_max:     "), spi_lock_words_max)
+  PRINTVAR(F("spi_lock_ticks_max:     "), spi_lock_ticks_max)
+  PRINTVAR(F("link_state:             "), link_state)
+}
+
+static void print_link_state(uint8_t state) {
+  switch (state) {
+  case LINK_OK: Serial.print(F("ok")); break;
+  case LINK_DEGRADED: Serial.print(F("degraded")); break;
+  case LINK_STALLED: Serial.print(F("stalled")); break;
+  case LINK_NO_DISPLAY: Serial.print(F("no display")); break;
+  }
+}
+
+void hp_display_link_print() {
+  Serial.print(F("link: "));
+  print_link_state(link_state);
+  Serial.print(F(" for "));
+  Serial.print(millis() - link_state_t);
+  Serial.println(F(" ms"));
+  PRINTVAR(F("frames/s:           "), link_fps)
+  PRINTVAR(F("words/s:            "), link_wps)
+  Serial.print(F("frames in sync:     "));
+  Serial.print(link_sync);
+  Serial.println(F("/16"));
+  Serial.print(F("word jitter, us:    avg "));
+  Serial.print(link_jitter * 4);
+  Serial.print(F(" max "));
+  Serial.println(link_jitter_max * 4);
+  Serial.println(F("times entered:"));
+  for (uint8_t i = 0; i < LINK_STATES; i++) {
+    Serial.print(F("  "));
+    print_link_state(i);
+    Serial.print(F(": "));
+    Serial.println(link_entered[i]);
+  }
 }
 
+#ifdef SPI_ISR_STATS
+/* move the per second rate window along, call from loop() */
+void hp_display_spi_stats_update() {
+  unsigned long now = millis();
+  if (now - spi_rate_t < 1000)
+    return;
+  spi_rate_t += 1000;
+  if (now - spi_rate_t >= 1000)
+    spi_rate_t = now; // loop() has been away for more than a second
+  noInterrupts();
+  uint32_t incom = spi_msgs_incom;
+  uint32_t sync_loss = spi_sync_loss;
+  interrupts();
+  spi_rate_i = (spi_rate_i + 1) % SPI_RATE_WINDOW;
+  uint32_t d = incom - spi_rate_last_incom;
+  spi_rate_incom[spi_rate_i] = d > 0xffff ? 0xffff : d;
+  d = sync_loss - spi_rate_last_sync_loss;
+  spi_rate_sync_loss[spi_rate_i] = d > 0xffff ? 0xffff : d;
+  spi_rate_last_incom = incom;
+  spi_rate_last_sync_loss = sync_loss;
+}
+
+void hp_display_spi_stats_reset() {
+  noInterrupts();
+  memset(spi_hist_loops, 0, sizeof(spi_hist_loops));
+  memset(spi_hist_isr_ticks, 0, sizeof(spi_hist_isr_ticks));
+  memset(spi_hist_spacing, 0, sizeof(spi_hist_spacing));
+  spi_rate_last_incom = spi_msgs_incom;
+  spi_rate_last_sync_loss = spi_sync_loss;
+  interrupts();
+  memset(spi_rate_incom, 0, sizeof(spi_rate_incom));
+  memset(spi_rate_sync_loss, 0, sizeof(spi_rate_sync_loss));
+  spi_rate_t = millis();
+}
+
+/* print the non-empty buckets of a histogram, bucket i is from i * width */
+static void print_hist(const __FlashStringHelper *name, uint16_t *hist, uint8_t width) {
+  uint16_t h[SPI_HIST_LEN];
+  noInterrupts();
+  memcpy(h, hist, sizeof(h));
+  interrupts();
+  Serial.println(name);
+  for (uint8_t i = 0; i < SPI_HIST_LEN; i++) {
+    if (h[i] == 0)
+      continue;
+    Serial.print(F("  "));
+    Serial.print(i * width);
+    if (i == SPI_HIST_LEN - 1) {
+      Serial.print(F("- : "));
+    } else if (width > 1) {
+      Serial.print('-');
+      Serial.print((i + 1) * width - 1);
+      Serial.print(F(": "));
+    } else {
+      Serial.print(F(": "));
+    }
+    Serial.println(h[i]);
+  }
+}
+
+/* print a per second rate, for the window and the last second */
+static void print_rate(const __FlashStringHelper *name, uint16_t *rate) {
+  uint32_t sum = 0;
+  uint16_t max = 0;
+  for (uint8_t i = 0; i < SPI_RATE_WINDOW; i++) {
+    sum += rate[i];
+    if (rate[i] > max)
+      max = rate[i];
+  }
+  Serial.print(name);
+  Serial.print(F(" last s: "));
+  Serial.print(rate[spi_rate_i]);
+  Serial.print(F(", last "));
+  Serial.print(SPI_RATE_WINDOW);
+  Serial.print(F(" s: "));
+  Serial.print(sum);
+  Serial.print(F(", max/s: "));
+  Serial.println(max);
+}
+
+void hp_display_spi_stats_print() {
+  print_hist(F("poll loops per word:"), spi_hist_loops, 8);
+  print_hist(F("interrupt routine time, 4 us ticks:"), spi_hist_isr_ticks, 1);
+  print_hist(F("time between words, 4 us ticks:"), spi_hist_spacing, 32);
+  print_rate(F("incomplete words"), spi_rate_incom);
+  print_rate(F("sync losses     "), spi_rate_sync_loss);
+}
+#endif
+
 #ifdef SPIDEBUG
 void hp_display_print_last_msgs() {
   uint32_t a[16];
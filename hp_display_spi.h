@@ -27,10 +27,41 @@
 extern uint32_t spi_msgs[];
 extern uint8_t spi_frames; // incremented when we have got a complete new frame
 extern unsigned long spi_msg_last_t; // time of last received spi msg
+extern uint16_t spi_msgs_dirty; // bit per spi_msgs[] entry that changed since last snapshot
+
+#define SPI_WORD_TICKS 244 // nominal time between words, 976 us, in spi_tick()s
+
+/* link monitor states, link_state */
+#define LINK_OK 0
+#define LINK_DEGRADED 1   // many frames dropped lately, or much jitter
+#define LINK_STALLED 2    // words, but no complete frames
+#define LINK_NO_DISPLAY 3 // no words
+#define LINK_STATES 4
+#ifndef LINK_TIMEOUT_MS
+#define LINK_TIMEOUT_MS 50 // ~3 frames
+#endif
+#ifndef LINK_DROPS_MAX
+#define LINK_DROPS_MAX 2 // dropped frames among the last 16 (~250 ms) that are still ok
+#endif
+#ifndef LINK_JITTER_MAX
+#define LINK_JITTER_MAX 25 // average word period deviation, spi_tick()s (100 us)
+#endif
+
+extern uint8_t link_state;
+extern unsigned long link_state_t; // millis() when link_state was entered
+extern uint32_t link_entered[];    // times each state was entered
+extern uint8_t link_fps;           // frames committed the last second
+extern uint16_t link_wps;          // words received the last second
+extern uint8_t link_sync;          // of the last 16 frames, how many were committed
+extern uint8_t link_jitter;        // average word period deviation, spi_tick()s
+extern uint8_t link_jitter_max;    // largest deviation the last second
 
 void setup_hp_display_spi();
-// returns true if we have not got any SPI data the last seconds
+// handle received SPI words (unless done in the ISR) and update the link monitor, call from loop()
+void hp_display_spi_poll();
+// returns true if we have not got any SPI data for LINK_TIMEOUT_MS
 uint8_t hp_display_spi_timeout();
+void hp_display_link_print();
 
 uint8_t hp_display_spi_msg2gateno(uint8_t *spi_msg);
 inline uint32_t hp_display_msg(uint8_t msg_index) {
@@ -39,9 +70,20 @@ inline uint32_t hp_display_msg(uint8_t msg_index) {
   interrupts();
   return msg;
 }
+// copy the changed words of the last complete frame to frame[16], return mask of changed words
+uint16_t hp_display_snapshot(uint32_t *frame, uint32_t *frame_no);
 
 /* debugging */
 
+#ifdef SPI_ISR_STATS
+#define SPI_HIST_LEN 16
+#define SPI_RATE_WINDOW 8 // seconds
+// move the per second rate window along, call from loop()
+void hp_display_spi_stats_update();
+void hp_display_spi_stats_reset();
+void hp_display_spi_stats_print();
+#endif
+
 uint32_t hp_display_spi_read();
 void hp_display_spi_print_debug();
 void hp_display_print_last_msgs();
@@ -58,5 +100,16 @@ extern uint32_t last_spi_msg; // debug
 extern uint32_t spi_msgs_incom;
 extern uint32_t spi_msgs_ok;
 extern uint32_t spi_sync_loss;
+extern uint32_t spi_frames_committed;
+extern uint32_t spi_frames_dropped;
+extern uint32_t spi_frames_overwritten;
+extern uint16_t spi_msg_last_tick;
+extern uint32_t spi_resyncs;
+extern uint32_t spi_lock_words_sum;
+extern uint8_t spi_lock_words_max;
+extern uint16_t spi_lock_ticks_max;
+#ifdef SPI_ISR_RING
+extern uint32_t spi_ring_overflows;
+#endif
 extern uint32_t last_spi_msgs[];
 extern uint8_t last_spi_msgs_i;
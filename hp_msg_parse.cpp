@@ -23,51 +23,60 @@
 #include "hp_display_config.h" // include this before the other local files
 #include "hp_display_spi.h"
 #include "hp_msg_parse.h"
+#include "hp_profiles.h"
 
 
 /* exported variables, updated by update_disp() */
 uint8_t disp_text[13]; // display text
-uint8_t disp_separators[12]; // dot, comma, colon, semicolon, or null
-uint8_t disp_labels[12]; // 0 or 1 if label should be displayed
-uint8_t disp_highlights[12]; // 0 or 1 if character should be highlighted
-uint8_t disp_units_gate[5]; // 0 or 1 if unit should be displayed
-uint8_t disp_change; // Bitfield stating what fields changed
+disp_state_t disp_state; // labels, highlights, separators, units and Gate, packed
+uint16_t disp_change; // Bitfield stating what fields changed
 uint8_t disp_no_display_data; // Currently no display data from instrument
+uint16_t disp_blink = 0;        // bit per character position, set if it blinks
+uint16_t disp_blink_period = 0; // ms, a full on and off cycle
+unsigned long disp_blink_t0 = 0; // millis() when the blinking characters were last lit
 /* exported variables, updated by update_disp_combined() (after an update_disp()) */
-char disp_text_combined[24];       // string built from disp_text and disp_separators
-char disp_highlights_combined[24]; // highlights matching disp_text_combined
+char disp_text_combined[24];       // string built from disp_text and separators
+char disp_highlights_combined[24]; // DISP_HL_* flags matching disp_text_combined
 size_t disp_text_combined_len = 0; // length of string in disp_text_combined and flags in disp_highlights_combined
 char disp_units_combined[6];       // Combination of the active units (excluding Gate!)
 size_t disp_units_combined_len = 0;// length of string in disp_units_combined
 char disp_labels_combined[64];     // Combination of the active labels, separated with space
 size_t disp_labels_combined_len = 0;// length of string in disp_labels_combined
+disp_value_t disp_value;           // disp_text_combined and disp_units_combined as a number
+const char* const value_unit_names[] = {"", "Hz", "s", "V", "A", "Ohm"}; // indexed by VALUE_UNIT_*
 
 /* internal variables, updated by update_disp() */
-uint8_t disp_text_prev[13] = {0,0,0,0,0,0,0,0,0,0,0,0,0};
-uint8_t disp_separators_prev[12] = {0,0,0,0,0,0,0,0,0,0,0,0};
-uint8_t disp_labels_prev[12] = {0,0,0,0,0,0,0,0,0,0,0,0};
-uint8_t disp_highlights_prev[12] = {0,0,0,0,0,0,0,0,0,0,0,0};
-uint8_t disp_units_gate_prev[5] = {0,0,0,0,0};
-
+uint8_t disp_text_raw[12]; // characters as decoded, before the 0/O guessing
+uint32_t disp_frame[16]; // snapshot of the last frame from the SPI interface
+uint32_t disp_frame_no = 0; // number of the frame in disp_frame
+/* blink detection, see update_blink() */
+uint8_t blink_prev[12];   // characters of the last frame, as received
+uint8_t blink_chars[12];  // the lit character, for the blink_cand and disp_blink positions
+uint16_t blink_cand = 0;  // positions that toggled together the last time
+uint8_t blink_n = 0;      // regular toggles of blink_cand in a row
+unsigned long blink_t = 0; // millis() of the last toggle of blink_cand
+uint16_t blink_half = 0;  // ms between the last two toggles
 
 /* exported constants */
 /* Text labels on display for HP 53131A/53132A/53181A/58503. */
-const char* const hp_display_labels[16] = {"Period", "Freq", "+Wid", "-Wid", "Rise", "Fall", "Time", "Ch1",
+const char* const hp_profile_53131a::labels[12] = {"Period", "Freq", "+Wid", "-Wid", "Rise", "Fall", "Time", "Ch1",
                  "Ch2", "Ch3", "Limit", "ExtRef"};
-const char* const hp_display_units_gate[5] = {"M", "Hz", "u", "s", "Gate"};
+const char* const hp_profile_53131a::units_gate[5] = {"M", "Hz", "u", "s", "Gate"};
 /* Text labels on display for HP 34401A. NOTE - NOT TESTED! */
-/*
-const char* const hp_display_labels_34401A[16] = {"*", "Adrs", "Rmt", "Man", "Trig", "Hold", "Mem", "Ratio",
-                 "Math", "ERROR", "Rear", "Shift", "", "", "", ""};
+const char* const hp_profile_34401a::labels[12] = {"*", "Adrs", "Rmt", "Man", "Trig", "Hold", "Mem", "Ratio",
+                 "Math", "ERROR", "Rear", "Shift"};
 // NOT TESTED/VERIFIED! Maybe "4W" is one label (4-wire)
-const char* const hp_display_units_gate_34401A[5] = {"4", "W", "[Cont]", "[???]", "[Diode]"};
-*/
+const char* const hp_profile_34401a::units_gate[5] = {"4", "W", "[Cont]", "[???]", "[Diode]"};
+
+/* the ones for the selected instrument */
+const char* const * const hp_display_labels = hp_profile::labels;
+const char* const * const hp_display_units_gate = hp_profile::units_gate;
 
 /* interal debug variables */
-uint8_t unknown_dp;
-// unknown characters we have seen
-int unk_n_chars = 0;
-uint16_t unk_chars[4];
+// unknown characters and separators we have seen, open addressing hash table
+unk_code_t unk_codes[UNK_CODES_LEN];
+uint8_t unk_codes_n = 0; // used entries
+uint32_t unk_dropped = 0; // unknowns not registered since the table was full
 
 
 inline uint8_t myisalpha(uint8_t c) {
@@ -75,100 +84,237 @@ inline uint8_t myisalpha(uint8_t c) {
 }
 
 
-/* Update disp_* variables */
-void update_disp(void) {
-  for (uint8_t i = 0; i < 12; i++) {
-    uint32_t m = __builtin_bswap32(hp_display_msg(i));
-    //uint16_t gates = m >> 20;
-    
-    uint16_t segs14 = m & 0x0000fcff;
-    disp_text[i] = map_seg14_code_x(segs14);
-    uint8_t segs_dp = (m & 0x00070000) >> 16;
-    if (i == 0) { 
-      disp_units_gate[2] = (segs_dp & 0x01) ? 1 : 0; // "u"
-      disp_units_gate[3] = (segs_dp & 0x02) ? 1 : 0; // "s"
-      disp_units_gate[4] = (segs_dp & 0x04) ? 1 : 0; // "Gate"
-      uint8_t segs_o = (m & 0x00000300) >> 8;
-      disp_units_gate[0] = (segs_o & 0x01) ? 1 : 0; // "M"
-      disp_units_gate[1] = (segs_o & 0x02) ? 1 : 0; // "Hz"
-   } else {
-      uint8_t c = '\0';
-      if (segs_dp == 0x02) c = '.';
-      else if (segs_dp == 0x03) c = ':';
-      else if (segs_dp == 0x06) c = ',';
-      else if (segs_dp == 0x07) c = ';';
-      else unknown_dp = segs_dp;
-      disp_separators[i] = c;
+/*
+ * Blink detection. A blinking field, like "OFF" in "LIM TEST: OFF",
+ * alternates between the characters and blanks every few hundred
+ * ms. Positions that toggle together BLINK_TOGGLES times at a steady
+ * pace are reported in disp_blink, and get their lit character in
+ * text[], so the text stops changing. Blinking stops when a toggle is
+ * late, or a position shows another character.
+ * Returns CHANGE_BLINK | CHANGE_TEXT if disp_blink changed.
+ */
+uint16_t update_blink(uint8_t *text) {
+  unsigned long now = millis();
+  uint16_t toggled = 0, other = 0, bit = 1;
+  uint16_t tracked = blink_cand | disp_blink;
+  uint16_t blink = disp_blink;
+
+  for (uint8_t i = 0; i < 12; i++, bit <<= 1) {
+    uint8_t c = text[i], p = blink_prev[i];
+    if (c == p)
+      continue;
+    blink_prev[i] = c;
+    uint8_t lit = c == ' ' ? p : c;
+    if ((c != ' ' && p != ' ') || ((tracked & bit) && blink_chars[i] != lit)) {
+      other |= bit;
+    } else {
+      toggled |= bit;
+      blink_chars[i] = lit;
     }
-    
-    uint8_t segs_label = (m & 0x00080000) >> 16;
-    disp_labels[i] = segs_label ? 1 : 0;
+  }
+  if (other & tracked) {
+    blink = 0; // the field shows something else now
+    blink_cand = 0;
   }
 
-  // update highlighting
-  for (uint8_t i = 0; i < 12; i++) {
-    disp_highlights[i] = 0;
+  if (toggled && blink_cand && (toggled & blink_cand) == blink_cand) {
+    toggled = blink_cand; // others toggling at the same time are just text changes
+  } else if (toggled && (blink || (toggled & blink_cand))) {
+    if (toggled & blink_cand) {
+      blink = 0; // only some of them toggled
+      blink_cand = 0;
+    }
+    toggled = 0; // keep following the blinking positions, if any
+  } else if (toggled) {
+    blink_cand = toggled; // new candidates
+    blink_n = 0;
+    blink_t = now;
+    toggled = 0;
   }
-  for (uint8_t i = 12; i < 16; i++) {
-    uint32_t msg = hp_display_msg(i);
-    if (msg == 0x00000080) // quick shortcut - little endian
-      continue;
-    uint8_t gateno = hp_display_spi_msg2gateno((uint8_t *) &msg);
-    uint32_t m = __builtin_bswap32(hp_display_msg(i)); // big endian
-    if (m & 0x000FFFFF)
-      disp_highlights[gateno] = 1;
-  }
-
-  // Zero and O (the letter) are ambiguous, try to decide using character before it
-  // Can not in general use character to the right to the decide, since that can be a unit ("V", "dB", ...)
-  for (int8_t i = 11; i >= 0; i--) {
-    if (disp_text[i] == '0') {
-      if ( ( (i < 11 && myisalpha(disp_text[i+1])) || // not leftmost and char to the left is alpha
-	     (i == 11 && myisalpha(disp_text[i-1]))) || // leftmost and char to the right is alpha
-	   ( i < 10 && disp_text[i+1] == ' ' && // space to the left, and
-	     (disp_text[i-1] == 'N') || // "N" to the right -> "ON"
-	     (i > 1 && disp_text[i-1] == 'F' && disp_text[i-2] == 'F' ))) { // "FF" to the right -> OFF
-	disp_text[i] = 'O';
-      }
+
+  if (toggled) {
+    uint16_t dt = now - blink_t > BLINK_HALF_MAX_MS ? BLINK_HALF_MAX_MS + 1 : now - blink_t;
+    if (dt < BLINK_HALF_MIN_MS || dt > BLINK_HALF_MAX_MS) {
+      blink = 0;
+      blink_n = 0;
+    } else if (blink_n >= 1 && (dt + dt / 4 < blink_half || dt > blink_half + blink_half / 4)) {
+      blink = 0; // irregular, start over
+      blink_n = 1;
+    } else if (blink_n < 255) {
+      blink_n++;
+    }
+    blink_half = dt;
+    blink_t = now;
+    if (text[__builtin_ctz(toggled)] != ' ')
+      disp_blink_t0 = now; // follow the instrument's phase
+    if (blink_n >= BLINK_TOGGLES - 1 && !blink) {
+      blink = blink_cand;
+      disp_blink_period = 2 * blink_half;
     }
+  } else if (blink && now - blink_t > blink_half + blink_half / 2) {
+    blink = 0; // a toggle is late, the text is steady now
+    blink_cand = 0;
   }
 
-  uint8_t ch = 0;
-  if (memlgcpycmp_a(disp_text_prev, disp_text) | // use bitwise or instead of logical or to always evaluate all
-      memlgcpycmp_a(disp_separators_prev, disp_separators) |
-      memlgcpycmp_a(disp_highlights_prev, disp_highlights))
-    ch |= CHANGE_TEXT;
-  if (memlgcpycmp_a(disp_labels_prev, disp_labels))
-    ch |= CHANGE_LABELS;
-  if (memlgcpycmp(disp_units_gate_prev, disp_units_gate, disp_units_n))
-    ch |= CHANGE_UNITS;
-  if (memlgcpycmp(disp_units_gate_prev+disp_units_n, disp_units_gate+disp_units_n, 1)) {
-    ch |= CHANGE_GATE;
+  bit = 1;
+  for (uint8_t i = 0; i < 12 && blink; i++, bit <<= 1) {
+    if (blink & bit)
+      text[i] = blink_chars[i];
   }
+  if (blink == disp_blink)
+    return 0;
+  disp_blink = blink;
+  return CHANGE_BLINK | CHANGE_TEXT;
+}
+
+
+/*
+ * Update disp_* variables
+ * Only the character positions whose SPI words changed since the last
+ * call are decoded, and if nothing changed there is nothing to do.
+ * P is the instrument profile, see hp_profiles.h.
+ */
+template <class P>
+void update_disp_p() {
+  uint16_t ch = 0;
+  uint16_t dirty = hp_display_snapshot(disp_frame, &disp_frame_no);
 
   // handle no new data
-  uint8_t new_no_disp = new_no_disp = hp_display_spi_timeout();
+  uint8_t new_no_disp = hp_display_spi_timeout();
   if (disp_no_display_data != new_no_disp) {
     disp_no_display_data = new_no_disp;
     ch |= CHANGE_ALL;
+    dirty = 0xffff; // fields were overwritten, decode everything again
   }
   if (new_no_disp) {
     const char no_disp_str[] PROGMEM = "(NO DISPLAY)";
     for (uint8_t i = 0; i < 12; i++)
       disp_text[11-i] = no_disp_str[i];
     disp_text[12] = '\0';
-    memset_a(disp_separators, 0);
-    memset_a(disp_labels, 0);
-    memset_a(disp_highlights, 0);
-    memset_a(disp_units_gate, 0);
+    memset(&disp_state, 0, sizeof(disp_state));
+    if (disp_blink)
+      ch |= CHANGE_BLINK;
+    disp_blink = 0;
+    blink_cand = 0;
+    disp_change = ch;
+    return;
+  }
+
+  if (dirty == 0 && !disp_blink) {
+    disp_change = ch; // nothing changed since last frame
+    return;
+  }
+
+  disp_state_t st = disp_state;
+  uint16_t bit = 1;
+  for (uint8_t i = 0; i < 12; i++, bit <<= 1) {
+    if (!(dirty & bit))
+      continue;
+    uint32_t m = __builtin_bswap32(disp_frame[i]);
+    //uint16_t gates = m >> 20;
+    
+    uint16_t segs14 = m & P::seg14_mask;
+    disp_text_raw[i] = map_seg14_code_x(segs14, i);
+    if (i == P::units_pos) {
+      uint8_t units_gate = 0;
+      if (m & P::unit_mask(0)) units_gate |= 0x01;
+      if (m & P::unit_mask(1)) units_gate |= 0x02;
+      if (m & P::unit_mask(2)) units_gate |= 0x04;
+      if (m & P::unit_mask(3)) units_gate |= 0x08;
+      if (m & P::unit_mask(4)) units_gate |= DISP_GATE;
+      st.units_gate = units_gate;
+    } else {
+      uint8_t segs_dp = (m & P::sep_mask) >> P::sep_shift;
+      uint8_t c = P::sep_char(segs_dp);
+      if (c == SEP_UNKNOWN) {
+        add_unk_separator(segs_dp, i);
+        c = '\0';
+      }
+      uint8_t shift = 2 * i;
+      st.sep_kinds &= ~(((uint32_t) 0x03) << shift);
+      if (c) {
+        st.seps |= bit;
+        st.sep_kinds |= ((uint32_t) disp_sep_kind(c)) << shift;
+      } else {
+        st.seps &= ~bit;
+      }
+    }
+    
+    if (m & P::label_mask)
+      st.labels |= bit;
+    else
+      st.labels &= ~bit;
+  }
+
+  // update highlighting
+  if (dirty & 0xf000) {
+    st.highlights = 0;
+    for (uint8_t i = 12; i < 16; i++) {
+      uint32_t msg = disp_frame[i];
+      if (msg == 0x00000080) // quick shortcut - little endian
+        continue;
+      uint8_t gateno = hp_display_spi_msg2gateno((uint8_t *) &msg);
+      uint32_t m = __builtin_bswap32(msg); // big endian
+      if (m & P::highlight_mask)
+        st.highlights |= ((uint16_t) 1) << gateno;
+    }
+  }
+
+  // what changed
+  if (st.seps != disp_state.seps || st.sep_kinds != disp_state.sep_kinds ||
+      st.highlights != disp_state.highlights)
+    ch |= CHANGE_TEXT;
+  if (st.labels != disp_state.labels)
+    ch |= CHANGE_LABELS;
+  if ((st.units_gate ^ disp_state.units_gate) & ~DISP_GATE)
+    ch |= CHANGE_UNITS;
+  if ((st.units_gate ^ disp_state.units_gate) & DISP_GATE)
+    ch |= CHANGE_GATE;
+  disp_state = st;
+
+  if ((dirty & 0x0fff) || disp_blink) { // blinking can time out without new data
+    // Redo the guessing on all positions, since it depends on the neighbours
+    uint8_t text[12];
+    memcpy(text, disp_text_raw, sizeof(text));
+
+    // Zero and O (the letter) are ambiguous, try to decide using character before it
+    // Can not in general use character to the right to the decide, since that can be a unit ("V", "dB", ...)
+    for (int8_t i = 11; i >= 0; i--) {
+      if (text[i] == '0') {
+        if ( ( (i < 11 && myisalpha(text[i+1])) || // not leftmost and char to the left is alpha
+               (i == 11 && myisalpha(text[i-1]))) || // leftmost and char to the right is alpha
+             ( i < 10 && text[i+1] == ' ' && // space to the left, and
+               (text[i-1] == 'N') || // "N" to the right -> "ON"
+               (i > 1 && text[i-1] == 'F' && text[i-2] == 'F' ))) { // "FF" to the right -> OFF
+          text[i] = 'O';
+        }
+      }
+    }
+
+    ch |= update_blink(text);
+
+    if (memlgcmp_a(text, disp_text)) { // disp_text has one more char, the null
+      memcpy(disp_text, text, sizeof(text));
+      ch |= CHANGE_TEXT;
+    }
   }
 
   disp_change = ch;
 }
 
 
-/* update disp_*_combined variables from disp_* variables - must call update_disp() first! */
-void update_disp_combined() {
+/* Update disp_* variables */
+void update_disp(void) {
+  update_disp_p<hp_profile>();
+}
+
+
+/*
+ * update disp_*_combined variables from disp_* variables - must call update_disp() first!
+ * P is the instrument profile, see hp_profiles.h.
+ */
+template <class P>
+void update_disp_combined_p() {
   int8_t j = 0;
   
   // update disp_text_combined and disp_highlights_combined
@@ -176,11 +322,15 @@ void update_disp_combined() {
     memset(disp_highlights_combined, 0, sizeof(disp_highlights_combined));
     for (int8_t i = 11; i >= 0 && j < (sizeof(disp_text_combined) - 1); i--) {
       disp_text_combined[j++] = disp_text[i];
-      if (disp_highlights[i]) {
-	disp_highlights_combined[j-1] = 1;
+      if (disp_highlight(i)) {
+	disp_highlights_combined[j-1] = DISP_HL_HIGHLIGHT;
+      }
+      if ((disp_blink >> i) & 0x01) {
+	disp_highlights_combined[j-1] |= DISP_HL_BLINK;
       }
-      if (disp_separators[i]) {
-	disp_text_combined[j++] = disp_separators[i];
+      char sep = disp_separator(i);
+      if (sep) {
+	disp_text_combined[j++] = sep;
       }
     }
     disp_text_combined[j] = '\0';
@@ -193,8 +343,8 @@ void update_disp_combined() {
     j = 0;
     disp_units_combined[0] = '\0';
     for(int8_t i = 0; i < disp_units_n && j < sizeof(disp_units_combined); i++) {
-      if (disp_units_gate[i] != 0) {
-	uint8_t *from = hp_display_units_gate[i];
+      if (disp_unit_gate(i)) {
+	const char *from = P::units_gate[i];
 	j = strlgcat_a(disp_units_combined, from, j);
       }
     }
@@ -206,66 +356,315 @@ void update_disp_combined() {
   if (disp_change & CHANGE_LABELS) {
     j = 0;
     disp_labels_combined[0] = '\0';
+    uint16_t labels = disp_state.labels;
     for(int8_t i = 11; i >= 0 && j < (sizeof(disp_labels_combined) - 1); i--) {
-      if (disp_labels[i] != 0) {
+      if (labels & 0x800) {
 	if (j > 0) {
 	  j = strlgspacefilln_a(disp_labels_combined, 1, j);
 	}
-	uint8_t *from = hp_display_labels[11-i];
+	const char *from = P::labels[11-i];
 	j = strlgcat_a(disp_labels_combined, from, j);
       }
+      labels <<= 1;
     }
     disp_labels_combined[j] = '\0';
     disp_labels_combined_len = j;
     disp_change |= CHANGE_LABELS_COMB;
   }
+
+  // update disp_value
+  if (disp_change & (CHANGE_TEXT_COMB | CHANGE_UNITS_COMB)) {
+    update_disp_value();
+  }
 }
 
-/* map a character segments combination into a character to display, null for unknown */
-uint8_t map_seg14_code(uint16_t segs14) {
-  for (int i = 0; i < seg_n; i++) {
-    if (seg_codes[i] == segs14) {
-      return seg_mapped_chars[i];
+/* update disp_*_combined variables from disp_* variables - must call update_disp() first! */
+void update_disp_combined() {
+  update_disp_combined_p<hp_profile>();
+}
+
+
+/*
+ * Measurement value parser, for logging. Integer only, no strtod or
+ * floats - the mantissa is accumulated digit by digit and the decimal
+ * point and unit prefix just move exp10.
+ */
+
+// stop accumulating digits here, more than the display can show anyway
+#define VALUE_MANTISSA_MAX 99999999999999999LL
+
+#define is_digit(c) ((c) >= '0' && (c) <= '9')
+
+/* SI prefix to power of ten, 0 if not a prefix */
+static int8_t value_prefix_exp10(char c) {
+  switch (c) {
+  case 'G': return 9;
+  case 'M': return 6;
+  case 'k': return 3;
+  case 'm': return -3;
+  case 'u': return -6;
+  case 'n': return -9;
+  case 'p': return -12;
+  }
+  return 0;
+}
+
+/*
+ * The accepted unit spellings, after the prefix: as in the profiles'
+ * units, and as the instruments write them in the text, in upper
+ * case. Case sensitive, as "m" and "M" are different prefixes. No
+ * upper case "S", "MS" in upper case only text is more likely
+ * milliseconds than megaseconds.
+ */
+static const struct {
+  const char *name;
+  uint8_t unit;
+} value_unit_spellings[] = {
+  {"Hz", VALUE_UNIT_HZ}, {"HZ", VALUE_UNIT_HZ},
+  {"s", VALUE_UNIT_S},
+  {"V", VALUE_UNIT_V}, {"VDC", VALUE_UNIT_V}, {"VAC", VALUE_UNIT_V},
+  {"A", VALUE_UNIT_A}, {"ADC", VALUE_UNIT_A}, {"AAC", VALUE_UNIT_A},
+  {"Ohm", VALUE_UNIT_OHM}, {"OHM", VALUE_UNIT_OHM},
+};
+
+/*
+ * Parse a unit, with an optional prefix, ending with null or spaces.
+ * Returns VALUE_UNIT_*, or 0xff if not one of value_unit_spellings[],
+ * and adds the prefix to *exp10.
+ */
+static uint8_t value_parse_unit(const char *s, int8_t *exp10) {
+  uint8_t len = 0;
+  while (s[len] != '\0' && s[len] != ' ')
+    len++;
+  for (uint8_t i = len; s[i] != '\0'; i++) {
+    if (s[i] != ' ')
+      return 0xff; // more text after the unit
+  }
+  if (len == 0)
+    return VALUE_UNIT_NONE;
+
+  int8_t prefix = value_prefix_exp10(s[0]);
+  if (prefix != 0 && len > 1) {
+    s++;
+    len--;
+  } else {
+    prefix = 0;
+  }
+  for (uint8_t i = 0; i < sizeof(value_unit_spellings) / sizeof(value_unit_spellings[0]); i++) {
+    const char *name = value_unit_spellings[i].name;
+    if (strlen(name) == len && strncmp(s, name, len) == 0) {
+      *exp10 += prefix;
+      return value_unit_spellings[i].unit;
     }
   }
-  add_unk_seg14(segs14);
-  return '\0';
+  return 0xff;
 }
 
-/* map a character segments combination into a character to display, x for unknown */
-uint8_t map_seg14_code_x(uint16_t segs14) {
-  for (int i = 0; i < seg_n; i++) {
-    if (seg_codes[i] == segs14) {
-      return seg_mapped_chars[i];
+/*
+ * Parse disp_text_combined, with the unit from disp_units_combined or
+ * from text after the number, into disp_value. Leading/trailing
+ * spaces, a sign, a decimal point, ',' or ' ' between digits as digit
+ * grouping, and an exponent ("1.2345E-03") are handled, anything else
+ * makes it invalid. Sets CHANGE_VALUE if disp_value changed.
+ */
+uint8_t update_disp_value() {
+  disp_value_t v;
+  const char *t = disp_text_combined;
+  uint8_t neg = 0, digits = 0, point = 0;
+
+  memset(&v, 0, sizeof(v));
+
+  while (*t == ' ')
+    t++;
+  if (*t == '-') {
+    neg = 1;
+    t++;
+  } else if (*t == '+') {
+    t++;
+  }
+  for (;; t++) {
+    char c = *t;
+    if (is_digit(c)) {
+      if (v.mantissa < VALUE_MANTISSA_MAX) {
+	v.mantissa = v.mantissa * 10 + (c - '0');
+	if (point)
+	  v.exp10--;
+      } else if (!point) {
+	v.exp10++; // drop the digit, keep the magnitude
+      }
+      digits++;
+    } else if (c == '.' && !point) {
+      point = 1;
+    } else if ((c == ',' || c == ' ') && digits > 0 && !point && is_digit(t[1])) {
+      // digit grouping before the decimal point
+    } else if ((c == ',' || c == ' ') && point && is_digit(t[-1]) && is_digit(t[1])) {
+      // digit grouping after the decimal point
+    } else {
+      break;
+    }
+  }
+
+  if (digits > 0) {
+    // exponent
+    if ((*t == 'E' || *t == 'e') &&
+	(is_digit(t[1]) || ((t[1] == '-' || t[1] == '+') && is_digit(t[2])))) {
+      uint8_t eneg = (t[1] == '-');
+      int16_t e = 0;
+      t += is_digit(t[1]) ? 1 : 2;
+      while (is_digit(*t) && e < 1000) {
+	e = e * 10 + (*(t++) - '0');
+      }
+      e = v.exp10 + (eneg ? -e : e);
+      if (e < -100 || e > 100)
+	digits = 0;
+      v.exp10 = e;
+    }
+    while (*t == ' ')
+      t++;
+  }
+
+  if (digits > 0) {
+    // unit, from the text if there is one there, else from the unit indicators
+    v.unit = value_parse_unit(*t != '\0' ? t : disp_units_combined, &v.exp10);
+    if (v.unit != 0xff) {
+      v.valid = 1;
+      if (neg)
+	v.mantissa = -v.mantissa;
     }
   }
-  add_unk_seg14(segs14);
-  return 'x';
+  if (!v.valid)
+    memset(&v, 0, sizeof(v));
+
+  if (memcmp(&v, &disp_value, sizeof(v)) != 0) {
+    disp_value = v;
+    disp_change |= CHANGE_VALUE;
+  }
+  return v.valid;
 }
 
-/* add an unmapped character to the unknowns array */
-void add_unk_seg14(uint16_t c) {
-  if (unk_n_chars >= (sizeof(unk_chars) / 2))
+/* print a value as mantissa, exponent and unit, like "1000000012e-2 Hz" */
+void print_value(int64_t mantissa, int8_t exp10, uint8_t unit) {
+  // Print can't do 64 bit integers
+  char buf[21];
+  uint8_t i = sizeof(buf) - 1;
+  uint64_t u = mantissa < 0 ? -(uint64_t)mantissa : mantissa;
+  buf[i] = '\0';
+  do {
+    buf[--i] = '0' + (u % 10);
+    u /= 10;
+  } while (u != 0 && i > 1);
+  if (mantissa < 0)
+    buf[--i] = '-';
+  Serial.print(buf + i);
+  Serial.print('e');
+  Serial.print(exp10);
+  Serial.print(' ');
+  Serial.println(value_unit_names[unit]);
+}
+
+/* print disp_value as mantissa, exponent and unit, like "1000000012e-2 Hz" */
+void print_disp_value() {
+  if (!disp_value.valid) {
+    Serial.println(F("no value"));
     return;
-  for (int i = 0; i < unk_n_chars; i++) {
-    if (unk_chars[i] == c)
-      return; // already registered
   }
-  unk_chars[unk_n_chars++] = c;
+  print_value(disp_value.mantissa, disp_value.exp10, disp_value.unit);
 }
 
-/* print unknown characters */
-void print_unknown_seg14s() {
-  for (int i = 0; i < unk_n_chars; i++) {
+/* map a character segments combination into a character to display, null for unknown */
+uint8_t map_seg14_code(uint16_t segs14, uint8_t pos) {
+  uint8_t c = seg_hash_lookup(segs14); // perfect hash from gencode.py, constant time
+  if (c == '\0') {
+    add_unk_seg14(segs14, pos);
+  }
+  return c;
+}
+
+/* map a character segments combination into a character to display, x for unknown */
+uint8_t map_seg14_code_x(uint16_t segs14, uint8_t pos) {
+  uint8_t c = seg_hash_lookup(segs14);
+  if (c == '\0') {
+    add_unk_seg14(segs14, pos);
+    return 'x';
+  }
+  return c;
+}
+
+/*
+ * Register an unknown code seen at character position pos in the
+ * unknowns table. Linear probing, no deletion, and when the table is
+ * full new codes are only counted in unk_dropped. Since only changed
+ * positions are decoded, count is the number of times the code
+ * appeared, not the number of frames it was shown in.
+ */
+void add_unk_code(uint16_t code, uint8_t pos) {
+  uint8_t h = ((uint16_t) (code * 0x9e37)) >> (16 - UNK_CODES_BITS);
+  for (uint8_t n = 0; n < UNK_CODES_LEN; n++) {
+    unk_code_t *e = &unk_codes[h];
+    if (e->count == 0) {
+      if (unk_codes_n >= UNK_CODES_LEN - 1) // keep an empty slot to end probing
+        break;
+      unk_codes_n++;
+      e->code = code;
+      e->first_frame = disp_frame_no;
+    } else if (e->code != code) {
+      h = (h + 1) & (UNK_CODES_LEN - 1);
+      continue;
+    }
+    if (e->count < 0xffff)
+      e->count++;
+    e->positions |= ((uint16_t) 1) << pos;
+    e->last_frame = disp_frame_no;
+    return;
+  }
+  unk_dropped++;
+}
+
+/* add an unmapped character to the unknowns table */
+void add_unk_seg14(uint16_t c, uint8_t pos) {
+  add_unk_code(c, pos);
+}
+
+/* add an unknown separator combination to the unknowns table */
+void add_unk_separator(uint8_t segs_dp, uint8_t pos) {
+  add_unk_code(UNK_SEPARATOR | segs_dp, pos);
+}
+
+/* print unknown codes, characters or separators */
+void print_unknown_codes(uint8_t separators) {
+  Serial.println(F("code     count  first_frame  last_frame  positions"));
+  for (uint8_t i = 0; i < UNK_CODES_LEN; i++) {
+    unk_code_t *e = &unk_codes[i];
+    if (e->count == 0 || ((e->code & UNK_SEPARATOR) != 0) != (separators != 0))
+      continue;
+    char pos[13]; // the character positions, leftmost first
+    for (uint8_t j = 0; j < 12; j++) {
+      pos[11-j] = (e->positions >> j) & 0x01 ? 'x' : '_';
+    }
+    pos[12] = '\0';
     Serial.print("0x");
-    Serial.println(unk_chars[i], 16);
+    Serial.print(e->code & ~UNK_SEPARATOR, 16);
+    Serial.print("\t ");
+    Serial.print(e->count);
+    Serial.print("\t ");
+    Serial.print(e->first_frame);
+    Serial.print("\t ");
+    Serial.print(e->last_frame);
+    Serial.print("\t ");
+    Serial.println(pos);
   }
 }
 
+/* print unknown characters */
+void print_unknown_seg14s() {
+  print_unknown_codes(false);
+}
+
 void print_unknown_separator() {
-  if(unknown_dp) {
-    Serial.print(F("Unknown separator: 0x"));
-    Serial.println(unknown_dp, 16);
+  print_unknown_codes(true);
+  if (unk_dropped) {
+    Serial.print(F("Not registered, table full: "));
+    Serial.println(unk_dropped);
   }
 }
 
@@ -279,7 +678,7 @@ uint8_t print_spi_msg(int8_t i, uint32_t msg) {
 //  Serial.print(" gates: ");
 //  Serial.print(gates, HEX);
 
-  uint8_t c = map_seg14_code_x(segs14);
+  uint8_t c = map_seg14_code_x(segs14, i);
   char str[] = {c, 0};
   Serial.print(str);
 
@@ -27,31 +27,65 @@
 
 /* in hp_msg_parse.cpp */
 
-/* exported constants */
-extern const char* const hp_display_labels[];
-extern const char* const hp_display_units_gate[];
+/* exported constants, for the instrument profile selected in hp_display_config.h */
+extern const char* const * const hp_display_labels;     // 12 labels, leftmost first
+extern const char* const * const hp_display_units_gate; // disp_units_n units, then Gate
 
 /* exported variables, updated by update_disp() */
 extern uint8_t disp_text[13]; // display text
-extern uint8_t disp_separators[12]; // dot, comma, colon, semicolon, or null
-extern uint8_t disp_labels[12]; // 0 or 1 if label should be displayed
-extern uint8_t disp_highlights[12]; // 0 or 1 if character should be highlighted
-extern uint8_t disp_units_gate[5]; // 0 or 1 if unit or Gate should be displayed
-extern uint8_t disp_change; // Bitfield stating what fields changed
+/* Everything but the text, packed. Character position 0 is the rightmost. */
+typedef struct {
+  uint16_t labels;     // bit per character position, set if its label should be displayed
+  uint16_t highlights; // bit per character position, set if it should be highlighted
+  uint16_t seps;       // bit per character position, set if it has a separator
+  uint32_t sep_kinds;  // 2 bits per character position, index in DISP_SEP_CHARS, 0 if no separator
+  uint8_t units_gate;  // bit per unit, disp_units_n units, then Gate (DISP_GATE)
+} disp_state_t;
+extern disp_state_t disp_state;
+extern uint16_t disp_change; // Bitfield stating what fields changed
 extern uint8_t disp_no_display_data; // Currently no display data from instrument
+/*
+ * Blinking characters, found by watching them alternate between the
+ * character and blank. disp_text then keeps the lit character, the
+ * sinks blink it themselves, with disp_blink_lit().
+ */
+extern uint16_t disp_blink;        // bit per character position, set if it blinks
+extern uint16_t disp_blink_period; // ms, a full on and off cycle
+extern unsigned long disp_blink_t0; // millis() when the blinking characters were last lit
 #define disp_units_n 4
+#define DISP_GATE (1 << disp_units_n) // Gate bit in disp_state.units_gate
+#define DISP_SEP_CHARS ".:,;" // separator character for each value in disp_state.sep_kinds
+
+/* accessors for disp_state */
+inline uint8_t disp_label(uint8_t i) { return (disp_state.labels >> i) & 0x01; }
+inline uint8_t disp_highlight(uint8_t i) { return (disp_state.highlights >> i) & 0x01; }
+inline uint8_t disp_unit_gate(uint8_t i) { return (disp_state.units_gate >> i) & 0x01; }
+inline uint8_t disp_gate() { return (disp_state.units_gate & DISP_GATE) ? 1 : 0; }
+/* dot, comma, colon, semicolon, or null */
+inline char disp_separator(uint8_t i) {
+  if (!((disp_state.seps >> i) & 0x01))
+    return '\0';
+  return DISP_SEP_CHARS[(disp_state.sep_kinds >> (2 * i)) & 0x03];
+}
+inline uint8_t disp_sep_kind(char c) { return c == '.' ? 0 : c == ':' ? 1 : c == ',' ? 2 : 3; }
+/* true if the blinking characters are lit at time now, millis() */
+inline uint8_t disp_blink_lit(unsigned long now) {
+  if (!disp_blink)
+    return 1;
+  return (now - disp_blink_t0) % disp_blink_period < disp_blink_period / 2;
+}
 /* exported variables, updated by update_disp_combined() (after an update_disp())
  * disp_text_combined can in theory be 23 long, but in reality seems to never exceed 16, except at display test.
  * disp_units_combined is normally max 3 long, except at display test. */
-extern char disp_text_combined[24];       // string built from disp_text and disp_separators
-extern char disp_highlights_combined[24]; // highlights matching disp_text_combined
+extern char disp_text_combined[24];       // string built from disp_text and separators
+extern char disp_highlights_combined[24]; // DISP_HL_* flags matching disp_text_combined
 extern size_t disp_text_combined_len;     // length of string in disp_text_combined and flags in disp_highlights_combined
 extern char disp_units_combined[6];       // Combination of the active units (excluding Gate!)
 extern size_t disp_units_combined_len;    // length of string in disp_units_combined
 extern char disp_labels_combined[64];     // Combination of the active labels, separated with space
 extern size_t disp_labels_combined_len;   // length of string in disp_labels_combined
 
-#define CHANGE_TEXT 0x01 /* also disp_separators and/or disp_highlights */
+#define CHANGE_TEXT 0x01 /* also separators and/or highlights */
 #define CHANGE_LABELS 0x02
 #define CHANGE_UNITS 0x04
 #define CHANGE_GATE 0x08
@@ -59,27 +93,80 @@ extern size_t disp_labels_combined_len;   // length of string in disp_labels_com
 #define CHANGE_TEXT_COMB 0x10 /* also disp_highlights_combined */
 #define CHANGE_UNITS_COMB 0x20
 #define CHANGE_LABELS_COMB 0x40
+#define CHANGE_VALUE 0x80 /* disp_value */
+#define CHANGE_BLINK 0x100 /* disp_blink or disp_blink_period, always with CHANGE_TEXT */
+
+/* flags in disp_highlights_combined */
+#define DISP_HL_HIGHLIGHT 0x01
+#define DISP_HL_BLINK 0x02
+
+/* blink detection */
+#define BLINK_TOGGLES 3        // regular toggles before a position counts as blinking
+#define BLINK_HALF_MIN_MS 50   // shortest and longest time between toggles
+#define BLINK_HALF_MAX_MS 2000
+
+/*
+ * The displayed measurement as a number, updated by
+ * update_disp_combined() when the text or units changed.
+ * The value is mantissa * 10^exp10, in unit, with any prefix (M, u,
+ * ...) folded into exp10. "10.000,000,12" "MHz" gives mantissa
+ * 1000000012, exp10 -2, VALUE_UNIT_HZ. No floats are used.
+ */
+#define VALUE_UNIT_NONE 0
+#define VALUE_UNIT_HZ 1
+#define VALUE_UNIT_S 2
+#define VALUE_UNIT_V 3
+#define VALUE_UNIT_A 4
+#define VALUE_UNIT_OHM 5
+typedef struct {
+  int64_t mantissa;
+  int8_t exp10;
+  uint8_t unit;  // VALUE_UNIT_*
+  uint8_t valid; // 0 if the display doesn't show a number
+} disp_value_t;
+extern disp_value_t disp_value;
+extern const char* const value_unit_names[]; // indexed by VALUE_UNIT_*
 
 /* Update disp_* variables */
 void update_disp(void);
 /* update disp_*_combined variables from disp_* variables - must call update_disp() first! */
 void update_disp_combined();
+/* parse disp_text_combined and disp_units_combined into disp_value, returns disp_value.valid */
+uint8_t update_disp_value();
+/* print disp_value as mantissa, exponent and unit, like "1000000012e-2 Hz" */
+void print_disp_value();
+void print_value(int64_t mantissa, int8_t exp10, uint8_t unit);
 
 /* map a character segments combination into a character to display, null for unknown */
-uint8_t map_seg14_code(uint16_t segs14);
+uint8_t map_seg14_code(uint16_t segs14, uint8_t pos);
 /* map a character segments combination into a character to display, x for unknown */
-uint8_t map_seg14_code_x(uint16_t segs14);
+uint8_t map_seg14_code_x(uint16_t segs14, uint8_t pos);
 
 void print_unknown_seg14s();
 void print_unknown_separator();
 
+/* Unknown codes seen, with statistics */
+#define UNK_CODES_BITS 4
+#define UNK_CODES_LEN (1 << UNK_CODES_BITS)
+#define UNK_SEPARATOR 0x0100 // flag for separator codes, not a segment bit
+typedef struct {
+  uint16_t code;        // segments, or UNK_SEPARATOR | separator bits
+  uint16_t count;       // times seen, 0 for unused entry, saturates at 0xffff
+  uint16_t positions;   // bit per character position it was seen on
+  uint32_t first_frame; // frame number when first and last seen
+  uint32_t last_frame;
+} unk_code_t;
+
 /* exported internal variables for debug */
-extern uint8_t unknown_dp;
-extern int unk_n_chars;
-extern uint16_t unk_chars[];
+extern unk_code_t unk_codes[];
+extern uint8_t unk_codes_n;
+extern uint32_t unk_dropped;
+extern uint32_t disp_frame_no; // frame number of the last decoded frame
 
 /* internal */
-void add_unk_seg14(uint16_t c);
+uint16_t update_blink(uint8_t *text); // from update_disp(), text[] is this frame's characters
+void add_unk_seg14(uint16_t c, uint8_t pos);
+void add_unk_separator(uint8_t segs_dp, uint8_t pos);
 
 /* Debug only - could really use some cleanup! */
 uint8_t print_spi_msg(int8_t i, uint32_t msg);
@@ -187,9 +274,13 @@ inline void strchrrepl(char * restrict str, char a, char b, uint8_t maxlen) {
 extern "C" {
 #endif
 
-extern uint16_t seg_n;
-extern uint16_t seg_codes[];
-extern uint8_t seg_mapped_chars[];
+extern uint16_t seg_n; // number of mapped codes
+extern uint16_t seg_hash_size; // number of slots in the hash table
+extern const uint16_t seg_hash_codes[]; // PROGMEM
+extern const uint8_t seg_hash_chars[]; // PROGMEM
+
+/* map a character segments combination into a character, null if not found */
+uint8_t seg_hash_lookup(uint16_t segs14);
 
 #ifdef __cplusplus
 } // extern "C"
@@ -0,0 +1,112 @@
+/*
+ * hp_display - program for Arduino for replacing the display on some
+ * discontinued HP/Agilent/Keysight instruments.
+ * Copyright (C) 2019  Ragnar Sundblad
+ *
+ * This file is part of the hp_display program.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Instrument profiles - which bits in the SPI words drive which
+ * display elements, and the texts for the labels and units, for the
+ * different instrument models.
+ *
+ * Everything is constant at compile time, the decoder is a template
+ * instantiated only for the selected profile, hp_profile, so there is
+ * no run time cost for supporting several models. Select the model in
+ * hp_display_config.h.
+ *
+ * The bit masks are for the SPI word as big endian, first bit on SPI
+ * as most significant, as in doc/protocol_descr.txt.
+ */
+
+#ifndef HP_PROFILES_H
+#define HP_PROFILES_H
+
+#include <stdint.h>
+
+#define SEP_UNKNOWN 0xff // returned by sep_char() for unknown separator segment combinations
+
+/* HP 53131A/53132A/53181A counters */
+struct hp_profile_53131a {
+  static constexpr uint8_t word_bytes = 4;           // bytes per SPI word
+  static constexpr uint32_t seg14_mask = 0x0000fcff; // 14 segment character
+  static constexpr uint32_t sep_mask = 0x00070000;   // separators
+  static constexpr uint8_t sep_shift = 16;
+  static constexpr uint32_t label_mask = 0x00080000; // text label under the character
+  static constexpr uint32_t highlight_mask = 0x000fffff; // anything lit in a highlight word x0-x3
+  static constexpr uint8_t units_pos = 0;            // position with units and Gate instead of separators
+
+  // bits for the units and Gate on units_pos, in the order of units_gate[]
+  static constexpr uint32_t unit_mask(uint8_t i) {
+    return i == 0 ? 0x00000100 : // "M"
+      i == 1 ? 0x00000200 :      // "Hz"
+      i == 2 ? 0x00010000 :      // "u"
+      i == 3 ? 0x00020000 :      // "s"
+      0x00040000;                // "Gate"
+  }
+
+  // bit in the 14 segment character for segment s, 0 to 13: A (top), B, C, D
+  // (bottom), E, F (clockwise), the middle bar's left and right halves,
+  // the upper and lower middle verticals, then the diagonals upper right,
+  // upper left, lower right and lower left, as in extras/charmap.py
+  static constexpr uint16_t seg_mask(uint8_t s) {
+    return s == 0 ? 0x0080 : s == 1 ? 0x0008 : s == 2 ? 0x0400 : s == 3 ? 0x4000 :
+      s == 4 ? 0x8000 : s == 5 ? 0x0004 : s == 6 ? 0x0002 : s == 7 ? 0x0001 :
+      s == 8 ? 0x0040 : s == 9 ? 0x2000 : s == 10 ? 0x0010 : s == 11 ? 0x0020 :
+      s == 12 ? 0x0800 : 0x1000;
+  }
+
+  // separator segments (shifted down by sep_shift) to character, null for none
+  static constexpr uint8_t sep_char(uint8_t segs_dp) {
+    return segs_dp == 0x00 ? '\0' :
+      segs_dp == 0x02 ? '.' :
+      segs_dp == 0x03 ? ':' :
+      segs_dp == 0x06 ? ',' :
+      segs_dp == 0x07 ? ';' :
+      SEP_UNKNOWN;
+  }
+
+  static const char* const labels[12];    // leftmost first
+  static const char* const units_gate[5]; // disp_units_n units, then Gate
+};
+
+/* HP 58503B GPS Time and Frequency Reference Receiver, same display as the 53131A */
+struct hp_profile_58503b : hp_profile_53131a {
+};
+
+/*
+ * HP 34401A multimeter. NOTE - NOT TESTED! Assumes the VFD driver is
+ * connected as on the 53131A, only the labels differ. The units/Gate
+ * elements seem to be more like mode labels on the multimeter.
+ */
+struct hp_profile_34401a : hp_profile_53131a {
+  static const char* const labels[12];
+  static const char* const units_gate[5];
+};
+
+
+#if defined(HP_34401A)
+typedef hp_profile_34401a hp_profile;
+#elif defined(HP_58503B)
+typedef hp_profile_58503b hp_profile;
+#else
+typedef hp_profile_53131a hp_profile;
+#endif
+
+static_assert(hp_profile::word_bytes == 4, "only 32 bit SPI words are handled");
+
+#endif // HP_PROFILES_H
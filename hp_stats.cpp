@@ -0,0 +1,260 @@
+/*
+ * hp_display - program for Arduino for replacing the display on some
+ * discontinued HP/Agilent/Keysight instruments.
+ * Copyright (C) 2019  Ragnar Sundblad
+ * 
+ * This file is part of the hp_display program.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Streaming statistics on the displayed measurement values (from
+ * disp_value), with constant time update and fixed memory:
+ *
+ * - Mean and standard deviation, with Welford's method.
+ *
+ * - Allan deviation for octave spaced tau, 1, 2, 4, ... times the
+ *   mean time between readings, tau0. Every level keeps the averages
+ *   from the level below pairwise averaged, and sums the squared
+ *   differences of consecutive averages. This is the non-overlapping
+ *   Allan deviation, which would need a history of readings to
+ *   overlap, with somewhat worse confidence than the overlapping one
+ *   for the same data.
+ *
+ * A reading is counted at the end of each measurement, when the Gate
+ * annunciator goes off. The instrument shows the new reading at about
+ * the same time, so it is taken at the first value change after that,
+ * or, if the reading is the same as the previous one, after
+ * STATS_SETTLE_MS. Without a Gate annunciator (or with gate times too
+ * short for it to be seen), each value change is a reading.
+ *
+ * floats are only 32 bits on AVR, too few for a 12 digit reading, so
+ * everything is calculated on the difference to the first reading.
+ */
+
+#include <Arduino.h>
+#include "hp_display_config.h" // include this before the other local files
+
+#ifdef HP_STATS
+
+#include "hp_msg_parse.h"
+#include "hp_stats.h"
+
+stats_t stats;
+
+void stats_reset() {
+  memset(&stats, 0, sizeof(stats));
+}
+
+/* feed an average into an Allan deviation level, and pairs of them into the next level */
+static void stats_adev_add(uint8_t level, float y) {
+  for (; level < STATS_ADEV_LEVELS; level++) {
+    stats_adev_t *a = &stats.adev[level];
+    if (a->flags & STATS_HAVE_LAST) {
+      float d = y - a->last;
+      a->sum_sq += d * d;
+      a->n++;
+    }
+    a->last = y;
+    a->flags |= STATS_HAVE_LAST;
+    if (!(a->flags & STATS_HAVE_FIRST)) {
+      a->first = y;
+      a->flags |= STATS_HAVE_FIRST;
+      return;
+    }
+    a->flags &= ~STATS_HAVE_FIRST;
+    y = (a->first + y) * 0.5;
+  }
+}
+
+/* add disp_value, if valid */
+void stats_add_value() {
+  if (!disp_value.valid)
+    return;
+  if (stats.n > 0 && (disp_value.exp10 != stats.exp10 || disp_value.unit != stats.unit))
+    stats_reset(); // another range or function, start over
+  unsigned long now = millis();
+  if (stats.n == 0) {
+    stats.ref_mantissa = disp_value.mantissa;
+    stats.exp10 = disp_value.exp10;
+    stats.unit = disp_value.unit;
+    stats.first_ms = now;
+  }
+  stats.last_ms = now;
+
+  float x = (float) (disp_value.mantissa - stats.ref_mantissa);
+  stats.n++;
+  float d = x - stats.mean;
+  stats.mean += d / stats.n;
+  stats.m2 += d * (x - stats.mean);
+
+  stats_adev_add(0, x);
+}
+
+static uint8_t stats_gate_last = 0;       // Gate annunciator in the previous frame
+static uint8_t stats_pending = 0;         // a measurement ended, its reading not yet added
+static unsigned long stats_gate_ms = 0;   // millis() when the Gate last went off
+static uint8_t stats_gate_seen = 0;       // the Gate has gone off within STATS_GATE_TIMEOUT_MS
+
+/* call for every new frame, after update_disp(), adds each new reading once, returns 1 if it did */
+uint8_t stats_frame() {
+  uint32_t n = stats.n;
+  unsigned long now = millis();
+  uint8_t gate = disp_gate();
+
+  if (stats_pending && ((disp_change & CHANGE_VALUE) || gate || now - stats_gate_ms >= STATS_SETTLE_MS)) {
+    stats_add_value();
+    stats_pending = 0;
+  }
+  if (stats_gate_seen && now - stats_gate_ms >= STATS_GATE_TIMEOUT_MS)
+    stats_gate_seen = 0;
+  if (stats_gate_last && !gate) {
+    stats_gate_ms = now;
+    stats_gate_seen = 1;
+    if (disp_change & CHANGE_VALUE)
+      stats_add_value(); // the reading came with the Gate going off
+    else
+      stats_pending = 1;
+  } else if (!stats_gate_seen && !stats_pending && (disp_change & CHANGE_VALUE)) {
+    stats_add_value();
+  }
+  stats_gate_last = gate;
+  return stats.n != n;
+}
+
+/* 10^e as a float */
+static float stats_pow10(int8_t e) {
+  float f = 1.0;
+  for (; e > 0; e--)
+    f *= 10.0;
+  for (; e < 0; e++)
+    f *= 0.1;
+  return f;
+}
+
+/* standard deviation, in the unit of the readings, 0 if less than two readings */
+float stats_stddev() {
+  if (stats.n < 2)
+    return 0.0;
+  return sqrt(stats.m2 / (stats.n - 1)) * stats_pow10(stats.exp10);
+}
+
+/* format x as "1.23e-3" with digits decimals into buf, needs digits + 9 bytes */
+uint8_t stats_fmt_sci(char *buf, float x, uint8_t digits) {
+  uint8_t i = 0;
+  int8_t e = 0;
+  if (!(x > -1e38 && x < 1e38)) { // inf or nan
+    strcpy(buf, "nan");
+    return 3;
+  }
+  if (x < 0) {
+    buf[i++] = '-';
+    x = -x;
+  }
+  if (x != 0.0) {
+    while (x >= 10.0) {
+      x *= 0.1;
+      e++;
+    }
+    while (x < 1.0) {
+      x *= 10.0;
+      e--;
+    }
+    float r = 0.5;
+    for (uint8_t k = 0; k < digits; k++)
+      r *= 0.1;
+    x += r;
+    if (x >= 10.0) {
+      x *= 0.1;
+      e++;
+    }
+  }
+  for (uint8_t k = 0; k <= digits; k++) {
+    uint8_t d = (uint8_t) x;
+    if (d > 9)
+      d = 9;
+    buf[i++] = '0' + d;
+    if (k == 0 && digits > 0)
+      buf[i++] = '.';
+    x = (x - d) * 10.0;
+  }
+  buf[i++] = 'e';
+  if (e < 0) {
+    buf[i++] = '-';
+    e = -e;
+  }
+  if (e >= 10)
+    buf[i++] = '0' + e / 10;
+  buf[i++] = '0' + e % 10;
+  buf[i] = '\0';
+  return i;
+}
+
+static void stats_print_sci(float x) {
+  char buf[16];
+  stats_fmt_sci(buf, x, 3);
+  Serial.print(buf);
+}
+
+void stats_print() {
+  if (stats.n == 0) {
+    Serial.println(F("no readings"));
+    return;
+  }
+  const char *unit = value_unit_names[stats.unit];
+  unsigned long tau0 = 0;
+  if (stats.n > 1)
+    tau0 = (stats.last_ms - stats.first_ms) / (stats.n - 1);
+
+  Serial.print(F("readings: "));
+  Serial.print(stats.n);
+  Serial.print(F(", tau0: "));
+  Serial.print(tau0);
+  Serial.println(F(" ms"));
+
+  // mean with three more decimals than the readings
+  float mean_r = stats.mean * 1000.0;
+  int64_t mean = stats.ref_mantissa * 1000 + (int64_t) (mean_r + (mean_r < 0 ? -0.5 : 0.5));
+  Serial.print(F("mean: "));
+  print_value(mean, stats.exp10 - 3, stats.unit);
+  Serial.print(F("std dev: "));
+  stats_print_sci(stats_stddev());
+  Serial.print(' ');
+  Serial.println(unit);
+
+  // Allan deviation, fractional when the reading is a frequency or time
+  float scale = stats_pow10(stats.exp10);
+  uint8_t fractional = stats.ref_mantissa != 0 &&
+    (stats.unit == VALUE_UNIT_HZ || stats.unit == VALUE_UNIT_S);
+  if (fractional)
+    scale = 1.0 / (float) (stats.ref_mantissa < 0 ? -stats.ref_mantissa : stats.ref_mantissa);
+  Serial.println(fractional ? F("tau (ms)  ADEV (fractional)  n") : F("tau (ms)  ADEV  n"));
+  for (uint8_t k = 0; k < STATS_ADEV_LEVELS; k++) {
+    stats_adev_t *a = &stats.adev[k];
+    if (a->n == 0)
+      break;
+    Serial.print(tau0 << k);
+    Serial.print(F("  "));
+    stats_print_sci(sqrt(a->sum_sq / (2.0 * a->n)) * scale);
+    if (!fractional) {
+      Serial.print(' ');
+      Serial.print(unit);
+    }
+    Serial.print(F("  "));
+    Serial.println(a->n);
+  }
+}
+
+#endif // HP_STATS
@@ -0,0 +1,78 @@
+/*
+ * hp_display - program for Arduino for replacing the display on some
+ * discontinued HP/Agilent/Keysight instruments.
+ * Copyright (C) 2019  Ragnar Sundblad
+ * 
+ * This file is part of the hp_display program.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Streaming statistics on the displayed measurement values, see
+ * hp_stats.cpp.
+ */
+
+#ifdef HP_STATS
+
+#define STATS_ADEV_LEVELS 8 // Allan deviation for tau0 * 1, 2, 4, ... 128
+
+/* Allan deviation accumulator for one tau */
+typedef struct {
+  float first;     // first of a pair of averages, to be averaged for the next level
+  float last;      // previous average, for the difference
+  float sum_sq;    // sum of squared differences of consecutive averages
+  uint32_t n;      // number of differences in sum_sq
+  uint8_t flags;   // STATS_HAVE_*
+} stats_adev_t;
+#define STATS_HAVE_FIRST 0x01
+#define STATS_HAVE_LAST 0x02
+
+typedef struct {
+  uint32_t n;             // number of readings
+  int64_t ref_mantissa;   // first reading, readings are kept as the difference to it
+  int8_t exp10;           // exponent and unit of all readings, a change restarts
+  uint8_t unit;
+  float mean;             // Welford's running mean and sum of squares, of the differences,
+  float m2;               // in units of 10^exp10
+  unsigned long first_ms; // millis() at the first and the last reading
+  unsigned long last_ms;
+  stats_adev_t adev[STATS_ADEV_LEVELS];
+} stats_t;
+
+extern stats_t stats;
+
+// time to wait for the value to change after the Gate went off, before
+// taking it as a reading equal to the previous one
+#ifndef STATS_SETTLE_MS
+#define STATS_SETTLE_MS 100
+#endif
+// time without the Gate going off before each value change counts as a reading
+#ifndef STATS_GATE_TIMEOUT_MS
+#define STATS_GATE_TIMEOUT_MS 3000
+#endif
+
+/* call for every new frame, after update_disp(), adds each new reading once, returns 1 if it did */
+uint8_t stats_frame();
+/* add disp_value, if valid */
+void stats_add_value();
+void stats_reset();
+void stats_print();
+/* format x as "1.23e-3" with digits decimals into buf, needs digits + 9 bytes */
+uint8_t stats_fmt_sci(char *buf, float x, uint8_t digits);
+/* standard deviation, in the unit of the readings, 0 if less than two readings */
+float stats_stddev();
+
+#endif // HP_STATS
@@ -0,0 +1,317 @@
+/*
+ * hp_display - program for Arduino for replacing the display on some
+ * discontinued HP/Agilent/Keysight instruments.
+ * Copyright (C) 2019  Ragnar Sundblad
+ * 
+ * This file is part of the hp_display program.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Binary change-only telemetry on the serial port.
+ *
+ * One record per decoded frame, with only the fields that changed
+ * since the last record sent, so it keeps up with the instrument's
+ * 64 frames/s at 115200 b/s. A record is:
+ *
+ *   uint8  record type, TELE_REC_DISPLAY
+ *   uint32 frame number (disp_frame_no)
+ *   uint32 time stamp, millis()
+ *   uint8  fields present, TELE_*
+ *   ...    the fields, in TELE_* bit order
+ *   uint16 CRC-16/CCITT-FALSE of everything above
+ *
+ * All little endian. The record is COBS encoded and ended with a 0
+ * byte, so a receiver can find the start of the next record whatever
+ * else was written on the serial port. Records with all fields also
+ * start with a 0 byte, to not be lost after text on the console. See
+ * extras/telemetry_decode.py.
+ *
+ * If the serial output buffer doesn't have room for the record it is
+ * skipped instead of blocking loop(). Fields are compared to what was
+ * last sent, so the next record carries the skipped changes too.
+ *
+ * With SPI_RAW_CAPTURE, the "raw" command instead streams every SPI
+ * word, from the SPI_ISR_RING drain in hp_display_spi_poll(), in
+ * groups of TELE_RAW_GROUP words:
+ *
+ *   TELE_REC_RAW:        uint32 millis(), uint8 n, then n times
+ *                        uint16 spi_tick() (4 us), uint8 gate, 4 bytes word as on SPI
+ *   TELE_REC_RAW_REPEAT: uint32 millis(), uint16 count, uint16 tick
+ *                        count more groups identical (words and gates) to the
+ *                        last TELE_REC_RAW, tick of the first word of the last one
+ *   TELE_REC_RAW_LOST:   uint32 millis(), uint32 spi_ring_overflows, uint32 spi_msgs_incom
+ *                        totals, sent when they changed - words were lost
+ *
+ * Raw records are written blocking, so nothing is dropped here; if
+ * the serial port can't keep up the SPI ring overflows, which is
+ * reported with TELE_REC_RAW_LOST.
+ */
+
+#include <Arduino.h>
+#include "hp_display_config.h" // include this before the other local files
+
+#ifdef HP_TELEMETRY
+
+#include "hp_display_spi.h"
+#include "hp_msg_parse.h"
+#include "hp_telemetry.h"
+
+uint8_t tele_on = TELE_OFF;  // TELE_OFF, TELE_DISPLAY or TELE_RAW
+uint32_t tele_records = 0;   // records sent
+uint32_t tele_skipped = 0;   // records not sent because the serial buffer was full
+
+/* what was last sent */
+static uint8_t tele_text[12];
+static disp_state_t tele_state;
+static uint16_t tele_blink, tele_blink_period;
+static uint8_t tele_keyframe = 0; // records until all fields are sent again
+
+#ifdef SPI_RAW_CAPTURE
+uint32_t tele_raw_words = 0; // words captured
+static uint8_t tele_raw[TELE_RAW_REC_MAX]; // the TELE_REC_RAW record being filled
+static uint8_t tele_raw_n = 0;             // words in it
+static uint8_t tele_raw_same = 0;          // all words so far same as in tele_raw_prev
+static uint8_t tele_raw_have_prev = 0;
+static uint32_t tele_raw_prev[TELE_RAW_GROUP]; // words of the last sent group
+static uint8_t tele_raw_prev_gates[TELE_RAW_GROUP];
+static uint16_t tele_raw_repeats = 0;      // identical groups not yet reported
+static uint16_t tele_raw_repeat_tick = 0;
+static uint32_t tele_raw_overflows = 0;    // lost counters last reported
+static uint32_t tele_raw_incom = 0;
+static void tele_raw_flush();
+#endif
+
+/* set mode, TELE_*, display records start with all fields */
+void tele_enable(uint8_t mode) {
+#ifdef SPI_RAW_CAPTURE
+  if (tele_on == TELE_RAW && mode != TELE_RAW)
+    tele_raw_flush();
+  if (mode == TELE_RAW && tele_on != TELE_RAW) {
+    tele_raw_n = 0;
+    tele_raw_have_prev = 0;
+    tele_raw_repeats = 0;
+    tele_raw_overflows = tele_raw_incom = 0xffffffff; // report the totals first
+  }
+#endif
+  tele_on = mode;
+  tele_keyframe = 0;
+}
+
+static uint16_t tele_crc16(const uint8_t *p, uint8_t len) {
+  uint16_t crc = 0xffff;
+  while (len--) {
+    crc ^= (uint16_t) *(p++) << 8;
+    for (uint8_t i = 0; i < 8; i++)
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+/* COBS encode len bytes from src into dst, with the trailing 0, returns the length */
+static uint8_t tele_cobs(uint8_t *dst, const uint8_t *src, uint8_t len) {
+  uint8_t code_i = 0, code = 1, j = 1;
+  for (uint8_t i = 0; i < len; i++) {
+    if (src[i] != 0) {
+      dst[j++] = src[i];
+      code++;
+    }
+    if (src[i] == 0 || code == 0xff) {
+      dst[code_i] = code;
+      code_i = j++;
+      code = 1;
+    }
+  }
+  dst[code_i] = code;
+  dst[j++] = 0;
+  return j;
+}
+
+static uint8_t tele_put16(uint8_t *p, uint16_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+  return 2;
+}
+
+static uint8_t tele_put32(uint8_t *p, uint32_t v) {
+  tele_put16(p, v);
+  tele_put16(p + 2, v >> 16);
+  return 4;
+}
+
+/*
+ * Add the CRC to the n bytes record in rec, which must have room for
+ * it, COBS encode and write it. Without block, the record is skipped
+ * if the serial buffer is too full. Returns 1 if written.
+ */
+static uint8_t tele_write(uint8_t *rec, uint8_t n, uint8_t resync, uint8_t block) {
+  uint8_t buf[TELE_BUF_LEN];
+
+  n += tele_put16(rec + n, tele_crc16(rec, n));
+  if (resync) {
+    buf[0] = 0; // end whatever came before
+    n = tele_cobs(buf + 1, rec, n) + 1;
+  } else {
+    n = tele_cobs(buf, rec, n);
+  }
+  if (!block && Serial.availableForWrite() < n) {
+    tele_skipped++;
+    return 0;
+  }
+  Serial.write(buf, n);
+  tele_records++;
+  return 1;
+}
+
+/* send a record for the last decoded frame if enabled, never blocks */
+void tele_send_frame() {
+  uint8_t rec[TELE_DISPLAY_REC_MAX];
+  uint8_t fields = 0, n;
+
+  if (tele_on != TELE_DISPLAY)
+    return;
+
+  if (tele_keyframe == 0) {
+    fields = TELE_ALL;
+  } else {
+    if (memcmp(tele_text, disp_text, sizeof(tele_text)) != 0)
+      fields |= TELE_TEXT;
+    if (tele_state.seps != disp_state.seps || tele_state.sep_kinds != disp_state.sep_kinds)
+      fields |= TELE_SEPS;
+    if (tele_state.highlights != disp_state.highlights)
+      fields |= TELE_HIGHLIGHTS;
+    if (tele_state.labels != disp_state.labels)
+      fields |= TELE_LABELS;
+    if (tele_state.units_gate != disp_state.units_gate)
+      fields |= TELE_UNITS;
+    if (tele_blink != disp_blink || tele_blink_period != disp_blink_period)
+      fields |= TELE_BLINK;
+  }
+
+  n = 0;
+  rec[n++] = TELE_REC_DISPLAY;
+  n += tele_put32(rec + n, disp_frame_no);
+  n += tele_put32(rec + n, millis());
+  rec[n++] = fields;
+  if (fields & TELE_TEXT) {
+    memcpy(rec + n, disp_text, 12);
+    n += 12;
+  }
+  if (fields & TELE_SEPS) {
+    n += tele_put16(rec + n, disp_state.seps);
+    n += tele_put32(rec + n, disp_state.sep_kinds);
+  }
+  if (fields & TELE_HIGHLIGHTS)
+    n += tele_put16(rec + n, disp_state.highlights);
+  if (fields & TELE_LABELS)
+    n += tele_put16(rec + n, disp_state.labels);
+  if (fields & TELE_UNITS)
+    rec[n++] = disp_state.units_gate;
+  if (fields & TELE_BLINK) {
+    n += tele_put16(rec + n, disp_blink);
+    n += tele_put16(rec + n, disp_blink_period);
+  }
+
+  if (!tele_write(rec, n, fields == TELE_ALL, 0))
+    return;
+
+  if (fields & TELE_TEXT)
+    memcpy(tele_text, disp_text, sizeof(tele_text));
+  tele_state = disp_state;
+  tele_blink = disp_blink;
+  tele_blink_period = disp_blink_period;
+  if (tele_keyframe == 0)
+    tele_keyframe = TELE_KEYFRAME_INTERVAL;
+  tele_keyframe--;
+}
+
+
+#ifdef SPI_RAW_CAPTURE
+/* send TELE_REC_RAW_LOST if words were lost since last checked */
+static void tele_raw_lost() {
+  noInterrupts();
+  uint32_t overflows = spi_ring_overflows;
+  uint32_t incom = spi_msgs_incom;
+  interrupts();
+  if (overflows == tele_raw_overflows && incom == tele_raw_incom)
+    return;
+  uint8_t rec[1 + 4 + 4 + 4 + 2];
+  uint8_t n = 0;
+  rec[n++] = TELE_REC_RAW_LOST;
+  n += tele_put32(rec + n, millis());
+  n += tele_put32(rec + n, overflows);
+  n += tele_put32(rec + n, incom);
+  tele_write(rec, n, 1, 1);
+  tele_raw_overflows = overflows;
+  tele_raw_incom = incom;
+}
+
+/* send TELE_REC_RAW_REPEAT for the identical groups not yet reported */
+static void tele_raw_repeat() {
+  if (tele_raw_repeats == 0)
+    return;
+  uint8_t rec[1 + 4 + 2 + 2 + 2];
+  uint8_t n = 0;
+  rec[n++] = TELE_REC_RAW_REPEAT;
+  n += tele_put32(rec + n, millis());
+  n += tele_put16(rec + n, tele_raw_repeats);
+  n += tele_put16(rec + n, tele_raw_repeat_tick);
+  tele_write(rec, n, 0, 1);
+  tele_raw_repeats = 0;
+}
+
+/* send the group in tele_raw, or count it as a repeat */
+static void tele_raw_flush() {
+  tele_raw_lost();
+  if (tele_raw_n == 0) {
+    tele_raw_repeat();
+    return;
+  }
+  if (tele_raw_same && tele_raw_have_prev && tele_raw_n == TELE_RAW_GROUP) {
+    tele_raw_repeats++;
+    tele_raw_repeat_tick = tele_raw[6] | (tele_raw[7] << 8);
+    if (tele_raw_repeats >= TELE_RAW_REPEAT_MAX)
+      tele_raw_repeat();
+  } else {
+    tele_raw_repeat();
+    tele_raw[0] = TELE_REC_RAW;
+    tele_put32(tele_raw + 1, millis());
+    tele_raw[5] = tele_raw_n;
+    tele_write(tele_raw, 6 + tele_raw_n * 7, 0, 1);
+    tele_raw_have_prev = (tele_raw_n == TELE_RAW_GROUP);
+  }
+  tele_raw_n = 0;
+}
+
+/* capture a raw SPI word, tick from spi_tick(), called from hp_display_spi_poll() */
+void tele_raw_word(uint32_t msg, uint16_t tick, uint8_t gate) {
+  if (tele_raw_n == 0)
+    tele_raw_same = 1;
+  if (!tele_raw_have_prev || tele_raw_prev[tele_raw_n] != msg || tele_raw_prev_gates[tele_raw_n] != gate) {
+    tele_raw_same = 0;
+    tele_raw_prev[tele_raw_n] = msg;
+    tele_raw_prev_gates[tele_raw_n] = gate;
+  }
+  uint8_t *p = tele_raw + 6 + tele_raw_n * 7;
+  p += tele_put16(p, tick);
+  *(p++) = gate;
+  memcpy(p, &msg, 4); // the bytes in the order they came on SPI
+  tele_raw_words++;
+  if (++tele_raw_n == TELE_RAW_GROUP)
+    tele_raw_flush();
+}
+#endif // SPI_RAW_CAPTURE
+
+#endif // HP_TELEMETRY
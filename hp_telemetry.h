@@ -0,0 +1,73 @@
+/*
+ * hp_display - program for Arduino for replacing the display on some
+ * discontinued HP/Agilent/Keysight instruments.
+ * Copyright (C) 2019  Ragnar Sundblad
+ * 
+ * This file is part of the hp_display program.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Binary change-only telemetry on the serial port, see hp_telemetry.cpp
+ */
+
+#ifdef HP_TELEMETRY
+
+/* record types */
+#define TELE_REC_DISPLAY 0x01
+#define TELE_REC_RAW 0x02        // raw SPI words, SPI_RAW_CAPTURE
+#define TELE_REC_RAW_REPEAT 0x03 // repeats of the last TELE_REC_RAW words
+#define TELE_REC_RAW_LOST 0x04   // words lost before reaching the capture
+
+/* tele_on modes */
+#define TELE_OFF 0
+#define TELE_DISPLAY 1 // TELE_REC_DISPLAY records, "bin" command
+#define TELE_RAW 2     // TELE_REC_RAW* records, "raw" command
+
+/* field flags in a TELE_REC_DISPLAY record, fields follow in this order */
+#define TELE_TEXT 0x01       // 12 bytes, disp_text, rightmost position first
+#define TELE_SEPS 0x02       // uint16 disp_state.seps, uint32 disp_state.sep_kinds
+#define TELE_HIGHLIGHTS 0x04 // uint16 disp_state.highlights
+#define TELE_LABELS 0x08     // uint16 disp_state.labels
+#define TELE_UNITS 0x10      // uint8 disp_state.units_gate
+#define TELE_BLINK 0x20      // uint16 disp_blink, uint16 disp_blink_period
+#define TELE_ALL 0x3f
+
+#define TELE_KEYFRAME_INTERVAL 64 // send all fields every this many records
+
+#define TELE_RAW_GROUP 16 // words per TELE_REC_RAW record, a frame
+#define TELE_RAW_REPEAT_MAX 64 // send TELE_REC_RAW_REPEAT at least every this many repeats
+
+#define TELE_DISPLAY_REC_MAX (1 + 4 + 4 + 1 + 12 + 6 + 2 + 2 + 1 + 4 + 2)
+#define TELE_RAW_REC_MAX (1 + 4 + 1 + TELE_RAW_GROUP * 7 + 2)
+#define TELE_REC_MAX TELE_RAW_REC_MAX // largest record, before COBS
+#define TELE_BUF_LEN (TELE_REC_MAX + TELE_REC_MAX / 254 + 3)  // COBS overhead and the 0 delimiters
+
+extern uint8_t tele_on;         // TELE_OFF, TELE_DISPLAY or TELE_RAW
+extern uint32_t tele_records;   // records sent
+extern uint32_t tele_skipped;   // records not sent because the serial buffer was full
+
+/* send a record for the last decoded frame if enabled, never blocks */
+void tele_send_frame();
+/* set mode, TELE_*, display records start with all fields */
+void tele_enable(uint8_t mode);
+#ifdef SPI_RAW_CAPTURE
+/* capture a raw SPI word, tick from spi_tick(), called from hp_display_spi_poll() */
+void tele_raw_word(uint32_t msg, uint16_t tick, uint8_t gate);
+extern uint32_t tele_raw_words; // words captured
+#endif
+
+#endif // HP_TELEMETRY
@@ -62,18 +62,122 @@ const int LCD_ROWS = 4;
 const int LCD_UNITS_FIELD_LEN = 5;
 const int LCD_GATE_FIELD_LEN = 5;
 
+static uint8_t lcd_blink_shown = 1; // the blinking characters are lit on the display
+
+/*
+ * Shadow of what is on the glass. Everything is written through
+ * lcd_print(), which only changes the shadow and marks the cells that
+ * differ as dirty, a queue that merges a cell changed twice into one
+ * write. lcd_20x4_hd44780_step(), called every loop(), drains it a few
+ * bytes at a time, each when the display's busy flag says it is ready,
+ * so a whole refresh never holds loop() up. A changed digit is then a
+ * setCursor and a write, not the whole 20 character line. Each byte
+ * to the display is two 4 bit transfers on the slow pin I/O.
+ */
+static char lcd_shadow[LCD_ROWS][LCD_COLS];
+static uint8_t lcd_dirty[(LCD_ROWS * LCD_COLS + 7) / 8]; // bit per shadow cell not yet written
+static uint8_t lcd_cursor_row = 0xff; // where the next write goes, 0xff if unknown
+static uint8_t lcd_cursor_col = 0;
+static uint8_t lcd_use_busy = 0;      // the busy flag can be read, R/W is wired
+static unsigned long lcd_queue_t = 0; // micros() when the queue last became non empty
+uint8_t lcd_queue_n = 0;      // dirty cells, the queue depth
+uint8_t lcd_queue_max = 0;    // deepest the queue has been
+uint32_t lcd_drain_us_max = 0; // longest time from a change to the queue being empty
+uint32_t lcd_bytes = 0; // command and data bytes written
+
+static inline uint8_t lcd_is_dirty(uint8_t cell) {
+  return (lcd_dirty[cell >> 3] >> (cell & 0x07)) & 0x01;
+}
+
+/* print s at col, row, queueing only the cells that changed */
+static void lcd_print(uint8_t col, uint8_t row, const char *s) {
+  for (; *s != '\0' && col < LCD_COLS; s++, col++) {
+    if (lcd_shadow[row][col] == *s)
+      continue;
+    lcd_shadow[row][col] = *s;
+    uint8_t cell = row * LCD_COLS + col;
+    if (lcd_is_dirty(cell))
+      continue;
+    lcd_dirty[cell >> 3] |= 1 << (cell & 0x07);
+    if (lcd_queue_n++ == 0)
+      lcd_queue_t = micros();
+    if (lcd_queue_n > lcd_queue_max)
+      lcd_queue_max = lcd_queue_n;
+  }
+}
+
+/* write the next queued byte, a data byte or a cursor move to the next dirty cell */
+static void lcd_drain_one() {
+  if (lcd_cursor_row < LCD_ROWS && lcd_cursor_col < LCD_COLS) {
+    uint8_t cell = lcd_cursor_row * LCD_COLS + lcd_cursor_col;
+    if (lcd_is_dirty(cell)) {
+      lcd.write(lcd_shadow[lcd_cursor_row][lcd_cursor_col]);
+      lcd_bytes++;
+      lcd_dirty[cell >> 3] &= ~(1 << (cell & 0x07));
+      lcd_queue_n--;
+      lcd_cursor_col++; // after the last column the address goes to another row, never matched
+      return;
+    }
+  }
+  for (uint8_t cell = 0; cell < LCD_ROWS * LCD_COLS; cell++) {
+    if (lcd_is_dirty(cell)) {
+      lcd_cursor_row = cell / LCD_COLS;
+      lcd_cursor_col = cell % LCD_COLS;
+      lcd.setCursor(lcd_cursor_col, lcd_cursor_row);
+      lcd_bytes++;
+      return;
+    }
+  }
+}
+
+/* write up to LCD_DRAIN_BYTES queued bytes, returns nonzero while more are queued, call from loop() */
+uint8_t lcd_20x4_hd44780_step() {
+  if (lcd_queue_n == 0)
+    return 0;
+  for (uint8_t i = 0; i < LCD_DRAIN_BYTES && lcd_queue_n != 0; i++) {
+    if (lcd_use_busy) {
+      int st = lcd.status();
+      if (st >= 0 && (st & 0x80))
+	break; // busy, the rest next loop()
+    }
+    lcd_drain_one();
+  }
+  if (lcd_queue_n != 0)
+    return 1;
+  uint32_t dt = micros() - lcd_queue_t;
+  if (dt > lcd_drain_us_max)
+    lcd_drain_us_max = dt;
+  return 0;
+}
+
+void lcd_20x4_hd44780_print() {
+  Serial.print(F("  queue: "));
+  Serial.print(lcd_queue_n);
+  Serial.print(F(", max: "));
+  Serial.print(lcd_queue_max);
+  Serial.print(F(", longest drain: "));
+  Serial.print(lcd_drain_us_max);
+  Serial.print(F(" us, busy flag: "));
+  Serial.println(lcd_use_busy ? F("yes") : F("no"));
+}
+
 
 void lcd_20x4_hd44780_setup() {
   int err = lcd.begin(LCD_COLS, LCD_ROWS);
-  lcd.setCursor(LCD_COLS/2 - 2, 0);
-  lcd.print("...");
+  if (lcd.status() >= 0) {
+    // R/W is wired, poll the busy flag instead of the library waiting the worst case execution times
+    lcd_use_busy = 1;
+    lcd.setExecTimes(0, 0);
+  }
+  memset(lcd_shadow, ' ', sizeof(lcd_shadow)); // begin() clears the display
+  lcd_print(LCD_COLS/2 - 2, 0, "...");
 }
 
 
-void lcd_20x4_hd44780_update() {
+void lcd_20x4_hd44780_update(uint16_t change) {
   static char line[LCD_COLS+1];
 
-  if (disp_change & (CHANGE_TEXT_COMB | CHANGE_UNITS_COMB)) {
+  if (change & (CHANGE_TEXT_COMB | CHANGE_UNITS_COMB)) {
     // check if we can fit text/numbers and units in one line
     if ((disp_text_combined_len + 1 + disp_units_combined_len) <= LCD_COLS) {
       uint8_t l;
@@ -81,19 +185,16 @@ void lcd_20x4_hd44780_update() {
       l = strlgspacefilln_a(line, 1, l);
       l = strlgcat_a(line, disp_units_combined, l);
       l = strlgspacefill_a(line, l);
-      lcd.setCursor(0, 0);
-      lcd.print(line);
-      // blank out line 2
+      lcd_print(0, 0, line);
+      // blank out line 2, only what is not blank already
       l = 0;
       l = strlgspacefill_a(line, l);
-      lcd.setCursor(0, 1);
-      lcd.print(line);
+      lcd_print(0, 1, line);
     } else {
       uint8_t l;
       l = strlgcpy_a(line, disp_text_combined);
       l = strlgspacefill_a(line, l);
-      lcd.setCursor(0, 0);
-      lcd.print(line);
+      lcd_print(0, 0, line);
       // line 2
       l = 0;
       if (disp_text_combined_len > 16) { // continuation of disp_text_combined
@@ -103,36 +204,32 @@ void lcd_20x4_hd44780_update() {
       l = strlgspacefilln(line, LCD_COLS - l - disp_units_combined_len, LCD_COLS, l);
       // copy units
       l = strlgcat_a(line, disp_units_combined, l);
-      lcd.setCursor(0, 1);
-      lcd.print(line);
+      lcd_print(0, 1, line);
     }
+    lcd_blink_shown = 1;
   }
 
-  if (disp_change & CHANGE_GATE) {
+  if (change & CHANGE_GATE) {
     // display Gate
-    if(disp_units_gate[4] != 0) { // Gate
-      lcd.setCursor(LCD_COLS - LCD_GATE_FIELD_LEN + 1, 3);
-      lcd.print((char *) hp_display_units_gate[4]);
+    if(disp_gate()) {
+      lcd_print(LCD_COLS - LCD_GATE_FIELD_LEN + 1, 3, (char *) hp_display_units_gate[4]);
     } else {
-      lcd.setCursor(LCD_COLS - LCD_GATE_FIELD_LEN, 3);
-      lcd.print("     ");
+      lcd_print(LCD_COLS - LCD_GATE_FIELD_LEN, 3, "     ");
     }
   }
 
-  if (disp_change & CHANGE_LABELS_COMB) {
+  if (change & CHANGE_LABELS_COMB) {
     // display labels - on one or two rows
     const uint8_t LCD_COLS_LR2 = LCD_COLS - LCD_GATE_FIELD_LEN;
     if ( disp_labels_combined_len <= LCD_COLS ) {
       uint8_t l;
       l = strlgcpy_a(line, disp_labels_combined);
       l = strlgspacefill_a(line, l);
-      lcd.setCursor(0, 2);
-      lcd.print(line);
+      lcd_print(0, 2, line);
       
       l = 0;
       l = strlgspacefill(line, LCD_COLS_LR2, l); // space fill from start of line
-      lcd.setCursor(0, 3);
-      lcd.print(line);
+      lcd_print(0, 3, line);
     } else {
       // need to wrap, find a space backwards up to 8 chars
       uint8_t index = LCD_COLS;
@@ -146,17 +243,38 @@ void lcd_20x4_hd44780_update() {
       uint8_t l;
       l = strlgcpy_a(line, disp_labels_combined);
       l = strlgspacefill_a(line, l);
-      lcd.setCursor(0, 2);
-      lcd.print(line);
+      lcd_print(0, 2, line);
       // copy second part of text
       if (disp_labels_combined[index] == ' ')
 	index += 1;
       l = strlgcpy(line, disp_labels_combined + index, LCD_COLS_LR2);
       l = strlgspacefill(line, LCD_COLS_LR2, l);
-      lcd.setCursor(0, 3);
-      lcd.print(line);
+      lcd_print(0, 3, line);
     }
   }
 }
 
+
+/*
+ * Blink the characters the decoder found blinking, see disp_blink,
+ * by writing just them, instead of the instrument's toggling making
+ * us redraw the text rows.
+ */
+void lcd_20x4_hd44780_blink() {
+  uint8_t lit = disp_blink_lit(millis());
+  if (lit == lcd_blink_shown)
+    return;
+  lcd_blink_shown = lit;
+  uint8_t two_rows = (disp_text_combined_len + 1 + disp_units_combined_len) > LCD_COLS;
+  for (uint8_t j = 0; j < disp_text_combined_len; j++) {
+    if (!(disp_highlights_combined[j] & DISP_HL_BLINK))
+      continue;
+    char c[2] = {lit ? disp_text_combined[j] : ' ', '\0'};
+    if (j < LCD_COLS)
+      lcd_print(j, 0, c);
+    if (two_rows && j >= 16) // continuation on line 2, as in lcd_20x4_hd44780_update()
+      lcd_print(j - 16, 1, c);
+  }
+}
+
 #endif // LCD_20X4_HD44780
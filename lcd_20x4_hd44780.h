@@ -21,7 +21,30 @@
 
 #ifdef LCD_20X4_HD44780
 
+// refresh limits, see hp_disp_sink.cpp
+#ifndef LCD_MIN_INTERVAL_MS
+#define LCD_MIN_INTERVAL_MS 50
+#endif
+#ifndef LCD_HOLD_MS
+#define LCD_HOLD_MS 100
+#endif
+// bytes written to the display per loop(), see lcd_20x4_hd44780_step()
+#ifndef LCD_DRAIN_BYTES
+#define LCD_DRAIN_BYTES 4
+#endif
+
 void lcd_20x4_hd44780_setup();
-void lcd_20x4_hd44780_update();
+// redraw what change, CHANGE_* bits, says
+void lcd_20x4_hd44780_update(uint16_t change);
+// toggle the blinking characters, call from loop()
+void lcd_20x4_hd44780_blink();
+// write a few queued bytes, returns nonzero while more are queued, call from loop()
+uint8_t lcd_20x4_hd44780_step();
+void lcd_20x4_hd44780_print(); // write queue statistics
+
+extern uint32_t lcd_bytes;        // command and data bytes written
+extern uint8_t lcd_queue_n;       // cells waiting to be written
+extern uint8_t lcd_queue_max;
+extern uint32_t lcd_drain_us_max; // longest time from a change to all written
 
 #endif // LCD_20X4_HD44780
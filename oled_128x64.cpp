@@ -24,8 +24,11 @@
  * OLED_128X64 - enable in hp_display_config.h to enable OLED screen
  * Default: 128x64 OLED with SSD1306 controller on i2c, address 0x3d
  * OLED_128X64_SSD1309_SW_SPI - instead a SSD1309 controller on SPI (software driven, bit banged)
- * OLED_SPEEDUP_TEST - test with only transferring the rows needing update to the oled
- * OLED_MEASURE_SPEED - lots of debug printing of time measurements in the drawing loop
+ * OLED_SPEEDUP_TEST - test with only transferring the rows needing update to the oled,
+ *   and for the text row only the tile columns where the text changed
+ * OLED_MEASURE_SPEED - debug printing of time measurements of the drawing steps
+ * OLED_PAGE_BUFFER - tile rows (8 pixels) in u8g2's buffer, 1, 2 or 8; 8 is a full
+ *   frame buffer, and then only the 8x8 tiles that changed are sent
  */ 
 
 /*
@@ -69,9 +72,11 @@
 //#include "hp_display_spi.h"
 #include "hp_msg_parse.h"
 #include "oled_128x64.h"
+#include "hp_stats.h"
 
 #ifdef USE_MOD_FONT
 #include "u8g2_font_helvB10_mod_tf.h"
+#include "u8g2_font_helvB10_mod_widths.h"
 #endif
 
 #define DISPLAY_WIDTH 128
@@ -94,7 +99,29 @@ const int clock=15, data=16, cs=19, dc=18, reset=17;
 
 
 
-uint8_t find_line_break(U8G2 *u8g2, char *str, uint8_t screen_width, uint8_t search_space);
+
+#if OLED_PAGE_BUFFER == 8
+#ifndef OLED_SPEEDUP_TEST
+#error "OLED_PAGE_BUFFER 8 needs OLED_SPEEDUP_TEST"
+#endif
+#ifdef OLED_128X64_SSD1309_SW_SPI
+#define U8G2_BASE_CLASS U8G2_SSD1309_128X64_NONAME0_F_4W_SW_SPI
+#else
+#define U8G2_BASE_CLASS U8G2_SSD1306_128X64_NONAME_F_HW_I2C
+#endif
+#elif OLED_PAGE_BUFFER == 2
+#ifdef OLED_128X64_SSD1309_SW_SPI
+#define U8G2_BASE_CLASS U8G2_SSD1309_128X64_NONAME0_2_4W_SW_SPI
+#else
+#define U8G2_BASE_CLASS U8G2_SSD1306_128X64_NONAME_2_HW_I2C
+#endif
+#else
+#ifdef OLED_128X64_SSD1309_SW_SPI
+#define U8G2_BASE_CLASS U8G2_SSD1309_128X64_NONAME0_1_4W_SW_SPI
+#else
+#define U8G2_BASE_CLASS U8G2_SSD1306_128X64_NONAME_1_HW_I2C
+#endif
+#endif
 
 
 #ifdef OLED_SPEEDUP_TEST
@@ -140,12 +167,6 @@ uint8_t u8g2_test_NextPage(u8g2_t *u8g2, uint8_t tile_rows) {
   return 1;
 }
 
-#ifdef OLED_128X64_SSD1309_SW_SPI
-#define U8G2_BASE_CLASS U8G2_SSD1309_128X64_NONAME0_1_4W_SW_SPI
-#else
-#define U8G2_BASE_CLASS U8G2_SSD1306_128X64_NONAME_1_HW_I2C
-#endif
-
 class u8g2_test : public U8G2_BASE_CLASS {
   uint8_t _update_tile_rows;
 public: 
@@ -176,21 +197,30 @@ u8g2_test u8g2(U8G2_R0);
 #else // OLED_SPEEDUP_TEST
 
 #ifdef OLED_128X64_SSD1309_SW_SPI
-U8G2_SSD1309_128X64_NONAME0_1_4W_SW_SPI u8g2(U8G2_R0, clock, data, cs, dc, reset);
+U8G2_BASE_CLASS u8g2(U8G2_R0, clock, data, cs, dc, reset);
 #else
-U8G2_SSD1306_128X64_NONAME_1_HW_I2C u8g2(U8G2_R0);
+U8G2_BASE_CLASS u8g2(U8G2_R0);
 #endif
 
 #endif // OLED_SPEEDUP_TEST
 
 
 u8g2_uint_t w_gate = 0; // width of the Gate label in pixels
+static uint8_t oled_blink_shown = 1; // the blinking characters are lit on the display
+uint32_t oled_bytes = 0; // display data bytes sent, for comparing drawing strategies
 
 #define ROW1_Y (2*8 - 2)
 #define ROW2_Y (4*8 - 2)
 #define ROW3_Y (6*8 - 2)
 #define ROW4_Y (8*8 - 2)
 
+#if OLED_PAGE_BUFFER == 8
+static uint8_t oled_shadow[DISPLAY_WIDTH * DISPLAY_HEIGHT / 8]; // the frame as sent to the display
+#define OLED_RAM_BYTES (2 * sizeof(oled_shadow)) // u8g2's frame buffer and the shadow
+#else
+#define OLED_RAM_BYTES (OLED_PAGE_BUFFER * DISPLAY_WIDTH)
+#endif
+
 void oled_128x64_setup() {
   u8g2.setI2CAddress(OLED_I2C_ADDR * 2);
   u8g2.begin();
@@ -212,7 +242,53 @@ void oled_128x64_setup() {
   do {
     u8g2.drawStr(0, ROW1_Y, "...");
   } while ( u8g2.nextPage() );
+#if OLED_PAGE_BUFFER == 8
+  memcpy(oled_shadow, u8g2.getBufferPtr(), sizeof(oled_shadow));
+#endif
+}
+
+void oled_128x64_print() {
+  Serial.print(F("  buffer: "));
+  Serial.print(OLED_PAGE_BUFFER);
+  Serial.print(F(" tile rows, "));
+  Serial.print(OLED_RAM_BYTES);
+  Serial.println(F(" bytes RAM"));
+}
+
+#if OLED_PAGE_BUFFER == 8
+/*
+ * With a full frame buffer, nothing is sent while drawing. Instead the
+ * tile rows that were drawn are compared to the shadow, what the
+ * display shows, and only the runs of 8x8 tiles that differ are sent.
+ * A changed digit is then a tile column or two, whatever row it is on,
+ * at the cost of 2 KB RAM for the buffer and the shadow.
+ */
+static void oled_clear_tile_rows(uint8_t tile_rows) {
+  uint8_t *buf = u8g2.getBufferPtr();
+  for (uint8_t row = 0; row < 8; row++) {
+    if ((tile_rows >> row) & 0x01)
+      memset(buf + row * DISPLAY_WIDTH, 0, DISPLAY_WIDTH);
+  }
+}
+
+static void oled_send_changed_tiles(uint8_t row) {
+  uint8_t *b = u8g2.getBufferPtr() + row * DISPLAY_WIDTH;
+  uint8_t *sh = oled_shadow + row * DISPLAY_WIDTH;
+  uint8_t start = 0xff; // first tile of the current run of changed tiles
+  for (uint8_t col = 0; col <= DISPLAY_WIDTH / 8; col++) {
+    uint8_t differs = col < DISPLAY_WIDTH / 8 && memcmp(b + col * 8, sh + col * 8, 8) != 0;
+    if (differs && start == 0xff) {
+      start = col;
+    } else if (!differs && start != 0xff) {
+      uint8_t n = col - start;
+      u8x8_DrawTile(u8g2_GetU8x8(u8g2.getU8g2()), start, row, n, b + start * 8);
+      memcpy(sh + start * 8, b + start * 8, n * 8);
+      oled_bytes += n * 8;
+      start = 0xff;
+    }
+  }
 }
+#endif // OLED_PAGE_BUFFER == 8
 
 /*
  * Strategy:
@@ -223,22 +299,245 @@ void oled_128x64_setup() {
  * Fourth row: If needed, more labels; end of row: Gate
  */
 
-void oled_128x64_update() {
-  static uint8_t labels_split_point = 0;
-  static uint8_t labels_split_point_2 = 0;
-  uint8_t disp_change_local = disp_change;
+/* blank the blinking characters in the text row, drawn with disp_text_combined */
+static void oled_blank_blinking() {
+  for (uint8_t j = 0; j < disp_text_combined_len; j++) {
+    if (!(disp_highlights_combined[j] & DISP_HL_BLINK))
+      continue;
+    char saved = disp_text_combined[j];
+    disp_text_combined[j] = '\0'; // ugly, but saves having a copy
+    u8g2_uint_t x = u8g2.getStrWidth(disp_text_combined);
+    disp_text_combined[j] = saved;
+    char c[2] = {saved, '\0'};
+    u8g2.setDrawColor(0);
+    u8g2.drawBox(x, 0, u8g2.getStrWidth(c), 2*8);
+    u8g2.setDrawColor(1);
+  }
+}
+
+#if defined(OLED_SPEEDUP_TEST) && OLED_PAGE_BUFFER != 8
+static char oled_text_shown[sizeof(disp_text_combined)]; // the text row as drawn, spaces replaced
+static uint32_t oled_text_blanked = 0; // bit per character drawn blanked, blink off phase
+static uint8_t oled_text_redraw = 1;   // send the whole row next time
+
+/*
+ * Draw the text row, and send only the tile columns (8 pixels) where
+ * it differs from what was drawn last time. As the font is
+ * proportional, a character with another width moves the rest of the
+ * row, but a changed digit is just one or two tile columns, instead
+ * of the 2 * 128 bytes of the whole row.
+ */
+static void oled_draw_text() {
+  u8g2_t *u = u8g2.getU8g2();
+  uint32_t blanked = 0;
+
+#ifdef USE_MOD_FONT
+  strchrrepl_a(disp_text_combined, ' ', '\xa0'); // as in oled_draw()
+#endif
+  if (!oled_blink_shown) {
+    for (uint8_t j = 0; j < disp_text_combined_len; j++) {
+      if (disp_highlights_combined[j] & DISP_HL_BLINK)
+	blanked |= ((uint32_t) 1) << j;
+    }
+  }
+
+  // changed pixel columns, x0 to x1, both the old and the new glyphs
+  uint16_t x0 = DISPLAY_WIDTH, x1 = 0;
+  uint16_t x_new = 0, x_old = 0;
+  char c_new = disp_text_combined[0], c_old = oled_text_shown[0];
+  for (uint8_t j = 0; c_new != '\0' || c_old != '\0'; j++) {
+    uint16_t w_new = c_new ? u8g2_GetGlyphWidth(u, (uint8_t) c_new) : 0;
+    uint16_t w_old = c_old ? u8g2_GetGlyphWidth(u, (uint8_t) c_old) : 0;
+    if (c_new != c_old || x_new != x_old || (((blanked ^ oled_text_blanked) >> j) & 0x01)) {
+      uint16_t lo = x_new < x_old ? x_new : x_old;
+      uint16_t hi = x_new + w_new > x_old + w_old ? x_new + w_new : x_old + w_old;
+      if (lo < x0)
+	x0 = lo > 0 ? lo - 1 : 0; // a pixel of margin, for glyphs wider than their advance
+      if (hi + 1 > x1)
+	x1 = hi + 1;
+    }
+    x_new += w_new;
+    x_old += w_old;
+    c_new = c_new ? disp_text_combined[j + 1] : '\0';
+    c_old = c_old ? oled_text_shown[j + 1] : '\0';
+  }
+  if (oled_text_redraw) {
+    x0 = 0;
+    x1 = DISPLAY_WIDTH;
+  }
+  if (x1 > DISPLAY_WIDTH)
+    x1 = DISPLAY_WIDTH;
+
+  if (x0 < x1) {
+    uint8_t col = x0 / 8;
+    uint8_t n = (x1 + 7) / 8 - col;
+    uint8_t tile_width = u8g2_GetU8x8(u)->display_info->tile_width;
+    uint8_t h = u->tile_buf_height;
+    for (uint8_t row = 0; row < 2; row += h) { // the text is on tile rows 0 and 1
+      u8g2_SetBufferCurrTileRow(u, row);
+      u8g2_ClearBuffer(u);
+      u8g2.drawStr(0, ROW1_Y, disp_text_combined);
+      if (blanked)
+	oled_blank_blinking();
+      uint8_t *buf = u8g2_GetBufferPtr(u);
+      for (uint8_t r = 0; r < h && row + r < 2; r++) {
+	u8x8_DrawTile(u8g2_GetU8x8(u), col, row + r, n, buf + (r * tile_width + col) * 8);
+	oled_bytes += n * 8;
+      }
+    }
+  }
+
+  strlgcpy_a(oled_text_shown, disp_text_combined);
+  oled_text_blanked = blanked;
+  oled_text_redraw = 0;
+#ifdef USE_MOD_FONT
+  strchrrepl_a(disp_text_combined, '\xa0', ' ');
+#endif
+}
+#endif // OLED_SPEEDUP_TEST && OLED_PAGE_BUFFER != 8
+
+/*
+ * Label layout, where disp_labels_combined is broken into ROW3 and ROW4.
+ * It is found in one pass, summing glyph widths from a table in flash
+ * (see extras/glyphwidths.py), and cached per label bitmask, as the
+ * string only depends on disp_state.labels.
+ */
+typedef struct {
+  uint16_t labels; // the disp_state.labels it is for
+  uint8_t split;   // end of ROW3, 0 if all labels fit on it
+  uint8_t split_2; // end of ROW4
+} oled_labels_layout_t;
+
+#ifndef OLED_LABELS_CACHE
+#define OLED_LABELS_CACHE 4
+#endif
+static oled_labels_layout_t oled_labels_cache[OLED_LABELS_CACHE];
+static uint8_t oled_labels_cache_n = 0;    // entries in use
+static uint8_t oled_labels_cache_next = 0; // entry to replace next
+
+static uint8_t oled_glyph_width(char c) {
+#ifdef USE_MOD_FONT
+  uint8_t i = (uint8_t) c - LABEL_GLYPH_FIRST;
+  if (i < sizeof(label_glyph_widths)) {
+    uint8_t w = pgm_read_byte(&label_glyph_widths[i]);
+    if (w != 0)
+      return w;
+  }
+#endif
+  return u8g2_GetGlyphWidth(u8g2.getU8g2(), (uint8_t) c);
+}
+
+static void oled_labels_layout(oled_labels_layout_t *l) {
+  const char *str = disp_labels_combined;
+  uint16_t x = 0;     // width of str[0..i)
+  uint16_t row_x = 0; // width of what is before the current row
+  uint8_t brk = 0;    // last space where ROW3 would fit
+  uint16_t brk_x = 0;
+  uint8_t fit = 0;    // last position where ROW3 would fit
+  uint16_t fit_x = 0;
+  uint8_t i;
+
+  l->split = 0;
+  for (i = 0; str[i] != '\0'; i++) {
+    if (str[i] == ' ' && l->split == 0) {
+      brk = i;
+      brk_x = x;
+    }
+    x += oled_glyph_width(str[i]);
+    if (x - row_x <= DISPLAY_WIDTH) {
+      if (l->split == 0) {
+	fit = i + 1;
+	fit_x = x;
+      }
+      continue;
+    }
+    if (l->split != 0)
+      break; // ROW4 is full too
+    if (brk == 0) { // no space, break anywhere
+      brk = fit;
+      brk_x = fit_x;
+    }
+    l->split = brk;
+    row_x = brk_x;
+    if (str[brk] == ' ')
+      row_x += oled_glyph_width(' '); // ROW4 starts after the space
+  }
+  l->split_2 = l->split ? i : 0;
+}
+
+static const oled_labels_layout_t *oled_labels_lookup() {
+  for (uint8_t i = 0; i < oled_labels_cache_n; i++) {
+    if (oled_labels_cache[i].labels == disp_state.labels)
+      return &oled_labels_cache[i];
+  }
+  oled_labels_layout_t *l = &oled_labels_cache[oled_labels_cache_next];
+  oled_labels_cache_next = (oled_labels_cache_next + 1) % OLED_LABELS_CACHE;
+  if (oled_labels_cache_n < OLED_LABELS_CACHE)
+    oled_labels_cache_n++;
+  l->labels = disp_state.labels;
+  oled_labels_layout(l);
+  return l;
+}
+
+/*
+ * The drawing is done in steps, one page (or, with the full frame
+ * buffer, one tile row) per oled_128x64_step(), called each loop(), so
+ * that a whole update, up to 1 KB over I2C, does not stall loop() for
+ * tens of milliseconds. Each page is drawn from the decoder's latest
+ * strings. Changes that come while drawing wait in the sink's pending
+ * bits, see hp_disp_sink.cpp, and are drawn by the next update, so a
+ * page already sent is never left stale.
+ */
+static uint16_t oled_render_change = 0; // CHANGE_* bits being drawn, 0 when idle
+#ifdef OLED_SPEEDUP_TEST
+static uint8_t oled_render_rows = 0;    // tile rows being drawn
+#endif
+#if OLED_PAGE_BUFFER == 8
+static uint8_t oled_render_row = 0;     // next tile row to send
+#endif
 #ifdef OLED_MEASURE_SPEED
-  unsigned long t0 = 0, t1 = 0, t2 = 0, t3 = 0, t4 = 0, t5 = 0, t6 = 0, t7 = 0, t8 = 0;
+static unsigned long oled_render_t0 = 0;    // micros() when the update began
+static unsigned long oled_render_step_max = 0; // longest step, us
+static uint8_t oled_render_steps = 0;
 #endif
+
+static void oled_render_begin(uint16_t change);
+static void oled_draw_page();
+
+void oled_128x64_update(uint16_t change) {
+  if (change & CHANGE_TEXT)
+    oled_blink_shown = disp_blink_lit(millis());
+  oled_render_begin(change);
+}
+
+/*
+ * Blink the characters the decoder found blinking, see disp_blink, by
+ * redrawing only the text row, instead of the instrument's toggling
+ * making the decoder report new text.
+ */
+void oled_128x64_blink() {
+  uint8_t lit = disp_blink_lit(millis());
+  if (lit == oled_blink_shown)
+    return;
+  oled_blink_shown = lit;
+  oled_render_begin(CHANGE_TEXT);
+}
+
+static void oled_render_begin(uint16_t disp_change_local) {
 #ifdef OLED_SPEEDUP_TEST
   uint8_t tile_rows = 0;
 #endif
 
+  while (oled_128x64_step())
+    ; // finish the update in progress, only if not called through the sinks
+
 #ifdef OLED_SPEEDUP_TEST
-  // test to have u8g2 only update the tile rows that we need
+#if OLED_PAGE_BUFFER == 8
   if (disp_change_local & CHANGE_TEXT) {
-    tile_rows |= 0x03;
+    tile_rows |= 0x03; // the tile diffing finds the columns that changed
   }
+#endif
+  // test to have u8g2 only update the tile rows that we need
   if (disp_change_local & CHANGE_UNITS) {
     tile_rows |= 0x0c;
   }
@@ -248,8 +547,13 @@ void oled_128x64_update() {
   if (disp_change_local & CHANGE_GATE) {
     tile_rows |= 0xc0;
   }
+#ifdef OLED_SHOW_STATS
+  if (disp_change_local & CHANGE_VALUE) {
+    tile_rows |= 0x0c; // the units row
+  }
+#endif
 
-  if (tile_rows == 0) {
+  if (tile_rows == 0 && !(disp_change_local & CHANGE_TEXT)) {
     return; // Nothing to update
   }
 #else
@@ -258,162 +562,174 @@ void oled_128x64_update() {
   }
   disp_change_local = 0xff; // always draw everything
 #endif
-
-#ifdef USE_MOD_FONT
-  if (disp_change_local & CHANGE_TEXT) {
-    // use our modded font to use spaces have same width as digits
-    // we actually change in the buffer we got, ugly, but saves memory
-    strchrrepl_a(disp_text_combined, ' ', '\xa0'); // replace space with our special non-breaking-space
+#ifdef OLED_SHOW_STATS
+  if (disp_change_local & CHANGE_VALUE) {
+    disp_change_local |= CHANGE_UNITS; // shares the row with the standard deviation
   }
 #endif
+  if (disp_change_local & CHANGE_LABELS) {
+    // ROW4 (last two tile rows) is redrawn with the labels, as they may
+    // continue there, so tell GATE to update itself
+    disp_change_local |= CHANGE_GATE;
+  }
 
 #ifdef OLED_MEASURE_SPEED
-  t0 = millis();
+  oled_render_t0 = micros();
+  oled_render_step_max = 0;
+  oled_render_steps = 0;
 #endif
+  oled_render_change = disp_change_local;
 #ifdef OLED_SPEEDUP_TEST
-  u8g2.firstPage(tile_rows);
+  oled_render_rows = tile_rows;
+#endif
+#if OLED_PAGE_BUFFER == 8
+  // no pages, draw it all in RAM now, the steps send the tiles that changed;
+  // clear what is redrawn, labels clear ROW4 too, as they may move the gate's labels
+  oled_clear_tile_rows(tile_rows);
+  oled_draw_page();
+  oled_render_row = 0;
+#elif defined(OLED_SPEEDUP_TEST)
+  if (tile_rows != 0 && !(disp_change_local & CHANGE_TEXT))
+    u8g2.firstPage(tile_rows); // else after the text row, which uses the buffer by itself
 #else
   u8g2.firstPage();
 #endif
+}
+
+/* draw the next page of an update, returns nonzero while there is more to do, call from loop() */
+uint8_t oled_128x64_step() {
+  if (oled_render_change == 0)
+    return 0;
 #ifdef OLED_MEASURE_SPEED
-  t1 = millis();
-#endif
-  do {
-    if (disp_change_local & CHANGE_TEXT) {
-      u8g2.drawStr(0, ROW1_Y, disp_text_combined);
-    }
-#ifdef OLED_MEASURE_SPEED
-    t2 = millis();
-#endif
-    if (disp_change_local & CHANGE_UNITS) {
-      // replace "us" with "[mu]s"
-      char *duc = disp_units_combined;
-      if (duc[0] == 'u' && duc[1] == 's') {
-	duc = "\xb5s"; // micro (mu) seconds
-      }
-      u8g2_uint_t w = u8g2.getStrWidth(duc);
-      u8g2.drawStr(DISPLAY_WIDTH - w, ROW2_Y, duc);
-    }
-#ifdef OLED_MEASURE_SPEED
-    t3 = millis();
-#endif
-    if (disp_change_local & CHANGE_LABELS) {
-      if (disp_labels_combined_len < 30 &&  // if the string is very long, the width may wrap on 8 bits
-	  u8g2.getStrWidth(disp_labels_combined) <= DISPLAY_WIDTH) {
-	// labels fit on one row
-	u8g2.drawStr(0, ROW3_Y, disp_labels_combined);
-	if (labels_split_point != 0) { // if previous labels were multi row
-#ifdef OLED_SPEEDUP_TEST
-	  tile_rows |= 0xc0; // need to also update ROW4 (last two tile rows)
-#endif
-	  disp_change_local |= CHANGE_GATE; // and tell GATE to update itself
-	  labels_split_point = 0;
-	}
-      } else {
-#ifdef OLED_MEASURE_SPEED
-    t4 = millis();
+  unsigned long t0 = micros();
 #endif
-	// need to split labels on two rows
+  uint8_t more;
+
+#if OLED_PAGE_BUFFER == 8
+  while (oled_render_row < 8 && !((oled_render_rows >> oled_render_row) & 0x01))
+    oled_render_row++;
+  if (oled_render_row < 8)
+    oled_send_changed_tiles(oled_render_row++);
+  more = oled_render_row < 8 && (oled_render_rows >> oled_render_row) != 0;
+#else
 #ifdef OLED_SPEEDUP_TEST
-	tile_rows |= 0xc0; // need to also update ROW4 (last two tile rows)
-#endif
-	disp_change_local |= CHANGE_GATE; // and tell GATE to update itself
-	labels_split_point = find_line_break(&u8g2, disp_labels_combined, DISPLAY_WIDTH, true);
-	if (labels_split_point == 0) // did not find a space, break on any char
-	  labels_split_point = find_line_break(&u8g2, disp_labels_combined, DISPLAY_WIDTH, false);
-	//labels_split_point_2 = labels_split_point + find_line_break(&u8g2, disp_labels_combined + labels_split_point, DISPLAY_WIDTH, false); // take as much of line 2 as possible, ignore space breaking
-	labels_split_point_2 = labels_split_point + 25; // actually finding the right char takes a lot of time.
-	// print first line
-	char saved = disp_labels_combined[labels_split_point];
-#ifdef OLED_MEASURE_SPEED
-	t5 = millis();
+  if (oled_render_change & CHANGE_TEXT) {
+    // the text row is drawn by itself, only the tile columns that changed
+    oled_draw_text();
+    oled_render_change &= ~CHANGE_TEXT;
+    more = oled_render_rows != 0;
+    if (more)
+      u8g2.firstPage(oled_render_rows);
+  } else
 #endif
-	disp_labels_combined[labels_split_point] = '\0'; // ugly, but saves having a copy
-	u8g2.drawStr(0, ROW3_Y, disp_labels_combined);
-	disp_labels_combined[labels_split_point] = saved;
-      }
-    }
-#ifdef OLED_MEASURE_SPEED
-    t6 = millis();
-#endif
-    if (disp_change_local & CHANGE_GATE) {
-      uint8_t display_gate = disp_units_gate[4] == 0 ? false : true;
-      if (labels_split_point) { // two row labels
-	char saved = disp_labels_combined[labels_split_point_2];
-	if(display_gate)
-	  u8g2.setClipWindow(0, 0, DISPLAY_WIDTH - w_gate - 5, 0xFFFF);
-	disp_labels_combined[labels_split_point_2] = '\0'; // ugly, but saves having a copy
-	u8g2.drawStr(0, ROW4_Y, disp_labels_combined + labels_split_point);
-	disp_labels_combined[labels_split_point_2] = saved;
-	if(display_gate)
-	  u8g2.setMaxClipWindow();
-      }
-      if(display_gate) { // Gate
-	u8g2.drawStr(DISPLAY_WIDTH - w_gate, ROW4_Y, (char *) hp_display_units_gate[4]);
-      }
-    }
-#ifdef OLED_MEASURE_SPEED
-    t7 = millis();
+  {
+    oled_draw_page();
+    oled_bytes += 8 * u8g2.getBufferTileWidth() * u8g2.getBufferTileHeight(); // sent by nextPage()
+    more = u8g2.nextPage();
+  }
 #endif
-  } while ( u8g2.nextPage() );
+
 #ifdef OLED_MEASURE_SPEED
-  t8 = millis();
+  unsigned long t1 = micros();
+  if (t1 - t0 > oled_render_step_max)
+    oled_render_step_max = t1 - t0;
+  oled_render_steps++;
+  if (!more) {
+    Serial.print(oled_render_change, 16);
+    Serial.print(F(" steps: "));
+    Serial.print(oled_render_steps);
+    Serial.print(F(" longest: "));
+    Serial.print(oled_render_step_max);
+    Serial.print(F(" us total: "));
+    Serial.print(t1 - oled_render_t0);
+    Serial.println(F(" us"));
+  }
 #endif
+  if (!more)
+    oled_render_change = 0;
+  return more;
+}
+
+/*
+ * Draw what oled_render_change says into the current page, or the
+ * whole frame buffer, from the latest strings.
+ */
+static void oled_draw_page() {
+  uint16_t disp_change_local = oled_render_change;
+  uint8_t labels_split_point = 0;
+  uint8_t labels_split_point_2 = 0;
+
+  if (disp_change_local & (CHANGE_LABELS | CHANGE_GATE)) {
+    // cheap, cached, and right also if the labels changed since the update began
+    const oled_labels_layout_t *l = oled_labels_lookup();
+    labels_split_point = l->split;
+    labels_split_point_2 = l->split_2;
+  }
 
 #ifdef USE_MOD_FONT
   if (disp_change_local & CHANGE_TEXT) {
-    strchrrepl_a(disp_text_combined, '\xa0', ' '); // undo what we did above
+    // use our modded font to use spaces have same width as digits
+    // we actually change in the buffer we got, ugly, but saves memory
+    strchrrepl_a(disp_text_combined, ' ', '\xa0'); // replace space with our special non-breaking-space
   }
 #endif
 
-#ifdef OLED_MEASURE_SPEED
-  Serial.print(disp_text_combined);
-  Serial.print('/');
-  Serial.print(disp_units_combined);
-  Serial.print('/');
-  Serial.print(disp_labels_combined);
-  Serial.println('<');
-  delay(75);
-  Serial.print(disp_change_local, 16);
-  Serial.print(" 1:");
-  Serial.print(t1 - t0);
-  Serial.print(" 2:");
-  Serial.print(t2 - t0);
-  Serial.print(" 3:");
-  Serial.print(t3 - t0);
-  Serial.print(" 4:");
-  Serial.print(t4 - t0);
-  Serial.print(" 5:");
-  Serial.print(t5 - t0);
-  Serial.print(" 6:");
-  Serial.print(t6 - t0);
-  Serial.print(" 7:");
-  Serial.print(t7 - t0);
-  Serial.print(" 8:");
-  Serial.println(t8 - t0);
-  delay(75);
+  if (disp_change_local & CHANGE_TEXT) {
+    u8g2.drawStr(0, ROW1_Y, disp_text_combined);
+    if (!oled_blink_shown)
+      oled_blank_blinking();
+  }
+  if (disp_change_local & CHANGE_UNITS) {
+    // replace "us" with "[mu]s"
+    char *duc = disp_units_combined;
+    if (duc[0] == 'u' && duc[1] == 's') {
+      duc = "\xb5s"; // micro (mu) seconds
+    }
+    u8g2_uint_t w = u8g2.getStrWidth(duc);
+    u8g2.drawStr(DISPLAY_WIDTH - w, ROW2_Y, duc);
+#ifdef OLED_SHOW_STATS
+    if (stats.n > 1) {
+      char sd[16] = "\xb1"; // plus-minus
+      stats_fmt_sci(sd + 1, stats_stddev(), 2);
+      u8g2.drawStr(0, ROW2_Y, sd);
+    }
 #endif
-}
-
-// WARNING - writes to string do avoit having to buffer
-// find index in string to break line to fit on screen
-uint8_t find_line_break(U8G2 *u8g2, char *str, uint8_t screen_width, uint8_t search_space) {
-  uint8_t split_point = 0;
-  for (uint8_t i = 0; str[i] != '\0'; i++) {
-    if (search_space)
-      for(; str[i] != '\0' && disp_labels_combined[i] != ' '; i++); // find next space
-    char saved = str[i];
-    str[i] = '\0'; // ugly, but saves having a copy
-    u8g2_uint_t w = u8g2->getStrWidth(str);
-    str[i] = saved; // restore
-    if (w < DISPLAY_WIDTH) {
-      split_point = i;
+  }
+  if (disp_change_local & CHANGE_LABELS) {
+    if (labels_split_point == 0) {
+      // labels fit on one row
+      u8g2.drawStr(0, ROW3_Y, disp_labels_combined);
     } else {
-      break;
+      // labels split on two rows, print first line
+      char saved = disp_labels_combined[labels_split_point];
+      disp_labels_combined[labels_split_point] = '\0'; // ugly, but saves having a copy
+      u8g2.drawStr(0, ROW3_Y, disp_labels_combined);
+      disp_labels_combined[labels_split_point] = saved;
+    }
+  }
+  if (disp_change_local & CHANGE_GATE) {
+    uint8_t display_gate = disp_gate();
+    if (labels_split_point) { // two row labels
+      char saved = disp_labels_combined[labels_split_point_2];
+      if(display_gate)
+	u8g2.setClipWindow(0, 0, DISPLAY_WIDTH - w_gate - 5, 0xFFFF);
+      disp_labels_combined[labels_split_point_2] = '\0'; // ugly, but saves having a copy
+      const char *row4 = disp_labels_combined + labels_split_point;
+      u8g2.drawStr(0, ROW4_Y, *row4 == ' ' ? row4 + 1 : row4);
+      disp_labels_combined[labels_split_point_2] = saved;
+      if(display_gate)
+	u8g2.setMaxClipWindow();
+    }
+    if(display_gate) { // Gate
+      u8g2.drawStr(DISPLAY_WIDTH - w_gate, ROW4_Y, (char *) hp_display_units_gate[4]);
     }
   }
 
-  return split_point;
+#ifdef USE_MOD_FONT
+  if (disp_change_local & CHANGE_TEXT) {
+    strchrrepl_a(disp_text_combined, '\xa0', ' '); // undo what we did above
+  }
+#endif
 }
 
 #endif // OLED_128X64
@@ -22,9 +22,29 @@
 
 #ifdef OLED_128X64
 
+// refresh limits, see hp_disp_sink.cpp
+#ifndef OLED_MIN_INTERVAL_MS
+#define OLED_MIN_INTERVAL_MS 50
+#endif
+#ifndef OLED_HOLD_MS
+#define OLED_HOLD_MS 100
+#endif
+
+// tile rows (8 pixels) in u8g2's buffer, 1, 2 or 8 (a full frame buffer, sending only changed tiles)
+#ifndef OLED_PAGE_BUFFER
+#define OLED_PAGE_BUFFER 1
+#endif
+
 void oled_128x64_setup();
-void oled_128x64_update();
+// redraw what change, CHANGE_* bits, says
+void oled_128x64_update(uint16_t change);
+// toggle the blinking characters, call from loop()
+void oled_128x64_blink();
+// draw the next page of an update, returns nonzero while there is more to do, call from loop()
+uint8_t oled_128x64_step();
 
 extern uint8_t oled_did_init;
+extern uint32_t oled_bytes; // display data bytes sent
+void oled_128x64_print(); // buffer mode and its RAM use
 
 #endif // OLED_128X64
@@ -25,102 +25,276 @@
 #include <stdlib.h>
 #include "hp_msg_parse.h"
 
+#define SEG_HASH_MUL 0xf9cf
+#define SEG_HASH_SHIFT 9
+
 uint16_t seg_n = 47;
-uint16_t seg_codes[] = {
-0xc48c, 
-0x2040, 
-0xc08b, 
-0x4489, 
-0x040f, 
-0x4487, 
-0xc487, 
-0x0488, 
-0xc48f, 
-0x448f, 
-0x2043, 
-0x0003, 
-0x64c9, 
-0x9014, 
-0xc40b, 
-0xa403, 
+uint16_t seg_hash_size = 128;
+const uint16_t seg_hash_codes[128] PROGMEM = {
 0x0000, 
-0xfcff, 
-0x1414, 
+0xffff, 
+0x64c8, 
+0xc48f, 
+0xffff, 
+0x808f, 
+0xffff, 
+0xc084, 
+0xffff, 
+0xffff, 
 0x0810, 
+0x44a1, 
+0xc48c, 
+0xffff, 
+0xffff, 
+0xffff, 
+0xffff, 
+0x8c2c, 
+0xffff, 
+0xc004, 
 0x1020, 
-0x3873, 
-0x1010, 
-0x4003, 
-0x208d, 
-0x848f, 
-0xc084, 
-0x64c8, 
-0xc087, 
+0xffff, 
+0xffff, 
+0xffff, 
+0xc40c, 
+0xffff, 
+0x5090, 
+0xc40b, 
+0xc487, 
+0x20c0, 
 0x8087, 
+0x1830, 
+0x2043, 
+0xffff, 
 0xc485, 
+0x848f, 
+0x843c, 
+0xffff, 
+0xffff, 
+0xffff, 
+0xffff, 
+0x2040, 
+0xffff, 
+0xffff, 
+0xffff, 
+0xffff, 
+0xffff, 
 0x840f, 
-0x60c0, 
+0xffff, 
+0xffff, 
+0xffff, 
+0xffff, 
+0xffff, 
+0xffff, 
+0xffff, 
 0x8816, 
-0xc004, 
-0x843c, 
-0x8c2c, 
-0x808f, 
-0xcc8c, 
+0xffff, 
+0xffff, 
+0xffff, 
+0x208d, 
+0xffff, 
+0xffff, 
+0xffff, 
+0x3873, 
+0xffff, 
 0x888f, 
-0x44a1, 
-0x20c0, 
-0xc40c, 
-0x9c0c, 
-0x1830, 
+0xffff, 
+0x448f, 
+0xa403, 
+0xffff, 
+0x1010, 
+0xffff, 
+0xcc8c, 
+0xffff, 
+0xffff, 
+0xffff, 
+0xfcff, 
+0xffff, 
+0xffff, 
+0xffff, 
+0xffff, 
+0xffff, 
+0xffff, 
+0xffff, 
+0xffff, 
+0x4489, 
+0x4003, 
+0xffff, 
+0x1414, 
+0xffff, 
+0xffff, 
 0x2030, 
-0x5090, 
+0x4487, 
+0xffff, 
+0xffff, 
+0xffff, 
+0xffff, 
+0xffff, 
+0xffff, 
+0xffff, 
+0xffff, 
+0xffff, 
+0xffff, 
+0xffff, 
+0xffff, 
+0xffff, 
+0xffff, 
+0xffff, 
+0x9c0c, 
+0xffff, 
+0xffff, 
+0x040f, 
+0xffff, 
+0xc08b, 
+0xffff, 
+0xffff, 
+0xffff, 
+0xffff, 
+0x0003, 
+0xffff, 
+0x0488, 
+0xffff, 
+0x9014, 
+0xffff, 
+0xffff, 
+0x60c0, 
+0xc087, 
+0x64c9, 
 };
-uint8_t seg_mapped_chars[] = {
-'0', 
-'1', 
-'2', 
-'3', 
-'4', 
-'5', 
-'6', 
-'7', 
-'8', 
-'9', 
-'+', 
-'-', 
-'B', 
-'V', 
-'d', 
-'m', 
+const uint8_t seg_hash_chars[128] PROGMEM = {
 ' ', 
-'#', 
-'%', 
+'\0', 
+'D', 
+'8', 
+'\0', 
+'P', 
+'\0', 
+'C', 
+'\0', 
+'\0', 
 '(', 
+'S', 
+'0', 
+'\0', 
+'\0', 
+'\0', 
+'\0', 
+'N', 
+'\0', 
+'L', 
 ')', 
-'*', 
-'/', 
-'=', 
-'?', 
-'A', 
-'C', 
-'D', 
-'E', 
+'\0', 
+'\0', 
+'\0', 
+'U', 
+'\0', 
+'Z', 
+'d', 
+'6', 
+'T', 
 'F', 
+'X', 
+'+', 
+'\0', 
 'G', 
+'A', 
+'M', 
+'\0', 
+'\0', 
+'\0', 
+'\0', 
+'1', 
+'\0', 
+'\0', 
+'\0', 
+'\0', 
+'\0', 
 'H', 
-'I', 
+'\0', 
+'\0', 
+'\0', 
+'\0', 
+'\0', 
+'\0', 
+'\0', 
 'K', 
-'L', 
-'M', 
-'N', 
-'P', 
-'Q', 
+'\0', 
+'\0', 
+'\0', 
+'?', 
+'\0', 
+'\0', 
+'\0', 
+'*', 
+'\0', 
 'R', 
-'S', 
-'T', 
-'U', 
-'W', 
-'X', 
+'\0', 
+'9', 
+'m', 
+'\0', 
+'/', 
+'\0', 
+'Q', 
+'\0', 
+'\0', 
+'\0', 
+'#', 
+'\0', 
+'\0', 
+'\0', 
+'\0', 
+'\0', 
+'\0', 
+'\0', 
+'\0', 
+'3', 
+'=', 
+'\0', 
+'%', 
+'\0', 
+'\0', 
 'Y', 
-'Z', 
+'5', 
+'\0', 
+'\0', 
+'\0', 
+'\0', 
+'\0', 
+'\0', 
+'\0', 
+'\0', 
+'\0', 
+'\0', 
+'\0', 
+'\0', 
+'\0', 
+'\0', 
+'\0', 
+'W', 
+'\0', 
+'\0', 
+'4', 
+'\0', 
+'2', 
+'\0', 
+'\0', 
+'\0', 
+'\0', 
+'-', 
+'\0', 
+'7', 
+'\0', 
+'V', 
+'\0', 
+'\0', 
+'I', 
+'E', 
+'B', 
 };
+
+/* map segments to character, null if not found */
+uint8_t seg_hash_lookup(uint16_t segs14) {
+  uint8_t h = ((uint16_t) (segs14 * SEG_HASH_MUL)) >> SEG_HASH_SHIFT;
+  if (pgm_read_word(&seg_hash_codes[h]) != segs14)
+    return '\0';
+  return pgm_read_byte(&seg_hash_chars[h]);
+}
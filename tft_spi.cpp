@@ -0,0 +1,464 @@
+/*
+ * hp_display - program for Arduino for replacing the display on some
+ * discontinued HP/Agilent/Keysight instruments.
+ * Copyright (C) 2019  Ragnar Sundblad
+ * 
+ * This file is part of the hp_display program.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * #defines:
+ * TFT_ST7735 - 160x128 color TFT with ST7735 controller, on SPI (software driven, bit banged)
+ * TFT_ILI9341 - instead a 320x240 one with ILI9341 controller
+ * TFT_HOST_PANEL - the bytes go to host_tft_write() instead of the pins, for
+ *   extras/hostbench, where a framebuffer stand-in counts them
+ */
+
+/*
+ * Wiring, SPI (software driven), the same pins as the SSD1309 OLED:
+ *   +-- SPI TFT display
+ *   |      +-- Arduino Pro Micro
+ *   |      |      +-- Arduino Nano v3.0
+ *   |      |      |
+ *  SCK   A3/21  A1/D15  # SPI clock (SCL, CLK)
+ *  SDA   A2/20  A2/D16  # SPI data (MOSI, DIN)
+ *  RES     2    A3/D17  # reset (RST)
+ *  DC    A1/19  A4/D18  # data/command (A0, RS)
+ *  CS    A0/18  A5/D19  # chip select
+ *  VCC    VCC    5V     # check if the module has a regulator and level shifters!
+ *  LED    VCC    5V     # backlight, check if it has a resistor
+ *  GND    GND    GND
+ */
+
+/*
+ * The TFT has far too many pixels to redraw for each reading over bit
+ * banged SPI, 150 KB for the ILI9341, and there is no RAM for a frame
+ * buffer. Instead the display is laid out as fixed cells: the 12
+ * character positions, drawn as 14 segment characters like the VFD,
+ * with their separators, a slot for each of the 12 labels, and one
+ * for each unit and the Gate. Each cell remembers what it shows, and
+ * only the cells that differ are redrawn, each with a window
+ * (CASET/RASET) and its pixels (RAMWR), one cell per loop().
+ */
+
+#include <Arduino.h>
+#include "hp_display_config.h" // include this before the other local files
+
+#ifdef TFT_SPI
+
+#include "hp_profiles.h"
+#include "hp_msg_parse.h"
+#include "tft_spi.h"
+
+#ifndef ARDUINO_NANO
+// Pro Micro
+const int clock=21, data=20, cs=18, dc=19, reset=2;
+#else
+// Nano
+const int clock=15, data=16, cs=19, dc=18, reset=17;
+#endif
+
+/* controller commands, the same on the ST7735 and the ILI9341 */
+#define TFT_SWRESET 0x01
+#define TFT_SLPOUT 0x11
+#define TFT_NORON 0x13
+#define TFT_DISPON 0x29
+#define TFT_CASET 0x2a
+#define TFT_RASET 0x2b
+#define TFT_RAMWR 0x2c
+#define TFT_MADCTL 0x36
+#define TFT_COLMOD 0x3a
+
+#define TFT_DELAY 0x80 // in an argument count in tft_init_seq[], a delay in ms follows the arguments
+
+/* init sequence: command, argument count, arguments, ..., ended with 0 */
+const uint8_t tft_init_seq[] PROGMEM = {
+  TFT_SWRESET, TFT_DELAY | 0, 150,
+  TFT_SLPOUT, TFT_DELAY | 0, 150,
+#ifdef TFT_ILI9341
+  TFT_COLMOD, 1, 0x55, // 16 bits per pixel
+  TFT_MADCTL, 1, 0x28, // landscape, BGR
+#else
+  TFT_COLMOD, 1, 0x05, // 16 bits per pixel
+  TFT_MADCTL, 1, 0xa0, // landscape, RGB
+#endif
+  TFT_NORON, TFT_DELAY | 0, 10,
+  TFT_DISPON, TFT_DELAY | 0, 100,
+  0
+};
+
+/* colors, RGB565 */
+#define TFT_BG 0x0000           // black
+#define TFT_FG 0x07f9           // lit segment, VFD blue green
+#define TFT_FG_HIGHLIGHT 0xffff // highlighted character, white
+
+/* layout, from the panel size */
+#define TFT_CELL_PITCH (TFT_WIDTH / 12)       // character positions
+#define TFT_CHAR_W (TFT_CELL_PITCH * 2 / 3)   // the rest is for the separator
+#define TFT_CHAR_H (TFT_CHAR_W * 2)
+#define TFT_STROKE (TFT_CHAR_W / 6 + 1)
+#define TFT_TEXT_X ((TFT_WIDTH - 12 * TFT_CELL_PITCH) / 2)
+#define TFT_TEXT_Y (TFT_HEIGHT / 8)
+#define TFT_SLOT_W (TFT_WIDTH / 4)            // label slots, 4 columns, 3 rows
+#define TFT_SMALL_PITCH ((TFT_SLOT_W - 4) / 6) // label and unit characters, 6 and a gap in a slot
+#define TFT_SMALL_W (TFT_SMALL_PITCH - 2)
+#define TFT_SMALL_H (TFT_SMALL_W * 2)
+#define TFT_SMALL_STROKE (TFT_SMALL_W / 6 + 1)
+#define TFT_SLOT_H (TFT_SMALL_H + TFT_SMALL_H / 2)
+#define TFT_LABELS_Y (TFT_TEXT_Y + TFT_CHAR_H + TFT_STROKE + TFT_HEIGHT / 10)
+#define TFT_UNIT_COLS (TFT_WIDTH / TFT_SMALL_PITCH) // units and Gate, one row of small characters
+#define TFT_UNITS_Y (TFT_LABELS_Y + 3 * TFT_SLOT_H + TFT_HEIGHT / 16)
+
+typedef struct {
+  uint8_t w, h, t, pitch; // character width, height, stroke and pitch, pixels
+} tft_font_t;
+static const tft_font_t tft_big = {TFT_CHAR_W, TFT_CHAR_H, TFT_STROKE, TFT_CELL_PITCH};
+static const tft_font_t tft_small = {TFT_SMALL_W, TFT_SMALL_H, TFT_SMALL_STROKE, TFT_SMALL_PITCH};
+
+/* cells, bits in tft_dirty */
+#define TFT_CELL_TEXT 0    // 12 character positions, position 0 is the rightmost
+#define TFT_CELL_LABEL 12  // 12 labels, bit i of disp_state.labels
+#define TFT_CELL_UNIT 24   // 4 units and Gate, bit i of disp_state.units_gate
+#define TFT_CELLS 29
+
+/* tft_attr_shown[] */
+#define TFT_ATTR_HIGHLIGHT 0x01
+#define TFT_ATTR_BLANK 0x02    // blinking, in the off phase
+#define TFT_ATTR_SEP_SHIFT 4   // separator, disp_sep_kind() + 1, 0 for none
+
+static char tft_text_shown[12];   // what each cell shows
+static uint8_t tft_attr_shown[12];
+static uint16_t tft_labels_shown = 0;
+static uint8_t tft_units_shown = 0;
+static uint8_t tft_unit_col[5];   // units and Gate, first column and length, see tft_units_layout()
+static uint8_t tft_unit_len[5];
+static uint32_t tft_dirty = 0;    // cells to redraw
+static uint8_t tft_lit = 1;       // the blinking characters are lit
+static uint32_t tft_cells = 0;    // cells drawn
+uint32_t tft_bytes = 0; // command and data bytes sent
+
+
+#ifdef TFT_HOST_PANEL
+extern "C" void host_tft_write(uint8_t dc, uint8_t b);
+
+static void tft_pins_setup() { }
+
+static inline void tft_write(uint8_t dc, uint8_t b) {
+  host_tft_write(dc, b);
+  tft_bytes++;
+}
+#else
+static volatile uint8_t *tft_clock_out, *tft_data_out, *tft_dc_out;
+static uint8_t tft_clock_bit, tft_data_bit, tft_dc_bit;
+
+static void tft_pins_setup() {
+  pinMode(clock, OUTPUT);
+  pinMode(data, OUTPUT);
+  pinMode(dc, OUTPUT);
+  pinMode(cs, OUTPUT);
+  pinMode(reset, OUTPUT);
+  digitalWrite(clock, LOW);
+  digitalWrite(cs, LOW); // the only device on these pins, always selected
+  digitalWrite(reset, LOW);
+  delay(10);
+  digitalWrite(reset, HIGH);
+  delay(120);
+  tft_clock_out = portOutputRegister(digitalPinToPort(clock));
+  tft_clock_bit = digitalPinToBitMask(clock);
+  tft_data_out = portOutputRegister(digitalPinToPort(data));
+  tft_data_bit = digitalPinToBitMask(data);
+  tft_dc_out = portOutputRegister(digitalPinToPort(dc));
+  tft_dc_bit = digitalPinToBitMask(dc);
+}
+
+/*
+ * Shift out b, most significant bit first, DC high for data and low
+ * for a command. Port writes, as digitalWrite() is ten times slower,
+ * with interrupts off, since the SPI interrupt routine may write the
+ * same port (SS_OUT_PIN on the Nano).
+ */
+static void tft_write(uint8_t is_data, uint8_t b) {
+  noInterrupts();
+  if (is_data)
+    *tft_dc_out |= tft_dc_bit;
+  else
+    *tft_dc_out &= ~tft_dc_bit;
+  for (uint8_t m = 0x80; m != 0; m >>= 1) {
+    if (b & m)
+      *tft_data_out |= tft_data_bit;
+    else
+      *tft_data_out &= ~tft_data_bit;
+    *tft_clock_out |= tft_clock_bit;
+    *tft_clock_out &= ~tft_clock_bit;
+  }
+  interrupts();
+  tft_bytes++;
+}
+#endif // TFT_HOST_PANEL
+
+/* set the window to w x h pixels at x, y, and start writing its pixels */
+static void tft_window(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+  uint16_t x1 = x + w - 1, y1 = y + h - 1;
+  tft_write(0, TFT_CASET);
+  tft_write(1, x >> 8);
+  tft_write(1, x);
+  tft_write(1, x1 >> 8);
+  tft_write(1, x1);
+  tft_write(0, TFT_RASET);
+  tft_write(1, y >> 8);
+  tft_write(1, y);
+  tft_write(1, y1 >> 8);
+  tft_write(1, y1);
+  tft_write(0, TFT_RAMWR);
+}
+
+static inline void tft_pixel(uint16_t color) {
+  tft_write(1, color >> 8);
+  tft_write(1, color);
+}
+
+/* 14 segment code of c, segment s at bit s (see hp_profile::seg_mask()), 0 if not known */
+static uint16_t tft_char_segs(char c) {
+  if (c == ' ' || c == '\0')
+    return 0;
+  uint16_t code = 0;
+  for (uint8_t pass = 0; pass < 2 && code == 0; pass++) {
+    uint8_t k = c == 'O' ? '0' : c; // the same on the VFD
+    for (uint16_t h = 0; h < seg_hash_size; h++) {
+      if (pgm_read_byte(&seg_hash_chars[h]) == k) {
+	code = pgm_read_word(&seg_hash_codes[h]);
+	break;
+      }
+    }
+    c = toupper(c); // the labels and units are mostly lower case, the VFD has few
+  }
+  uint16_t segs = 0;
+  for (uint8_t s = 0; s < 14; s++) {
+    if (code & hp_profile::seg_mask(s))
+      segs |= 1 << s;
+  }
+  return segs;
+}
+
+/* is pixel x, y of a character with segments segs lit */
+static uint8_t tft_seg_pixel(uint16_t segs, uint8_t x, uint8_t y, const tft_font_t *f) {
+  uint8_t w = f->w, h = f->h, t = f->t;
+  uint8_t cx = w / 2, my = h / 2;
+  uint8_t upper = y < my, left = x < cx;
+  uint16_t on = 0;
+
+  if (y < t)
+    on |= 1 << 0; // A
+  if (y >= h - t)
+    on |= 1 << 3; // D
+  if (x >= w - t)
+    on |= upper ? 1 << 1 : 1 << 2; // B, C
+  if (x < t)
+    on |= upper ? 1 << 5 : 1 << 4; // F, E
+  if (y + t / 2 >= my && y + t / 2 < my + t)
+    on |= left ? 1 << 6 : 1 << 7; // the middle bar
+  if (x + t / 2 >= cx && x + t / 2 < cx + t)
+    on |= upper ? 1 << 8 : 1 << 9; // the middle verticals
+  if (segs & 0x3c00) {
+    // diagonals, from the corners to the middle, folded into the upper left quarter
+    uint8_t qx = left ? x : w - 1 - x;
+    uint8_t qy = upper ? y : h - 1 - y;
+    if (qx >= t && qy >= t) {
+      int16_t a = cx - t, b = my - t;
+      int16_t d = (int16_t) (qx - t) * b - (int16_t) (qy - t) * a; // 0 on the line
+      int16_t len = a > b ? a + b / 2 : b + a / 2; // about the line's length
+      if (2 * abs(d) <= t * len)
+	on |= upper ? (left ? 1 << 11 : 1 << 10) : (left ? 1 << 13 : 1 << 12);
+    }
+  }
+  return (segs & on) != 0;
+}
+
+/* is pixel x, y of separator kind sep (disp_sep_kind() + 1) lit, x from the character's right */
+static uint8_t tft_sep_pixel(uint8_t sep, uint8_t x, uint8_t y) {
+  const uint8_t t = TFT_STROKE;
+  uint8_t x0 = (TFT_CELL_PITCH - TFT_CHAR_W - t) / 2;
+  uint8_t comma = sep == 3 || sep == 4;
+  if (y >= TFT_CHAR_H - t && y < TFT_CHAR_H && x >= x0 && x < x0 + t)
+    return 1; // the dot
+  if ((sep == 2 || sep == 4) && y >= TFT_CHAR_H / 3 && y < TFT_CHAR_H / 3 + t && x >= x0 && x < x0 + t)
+    return 1; // the upper dot of : and ;
+  if (comma && y >= TFT_CHAR_H && x + 1 >= x0 && x + 1 < x0 + t)
+    return 1; // the tail, below the characters
+  return 0;
+}
+
+static uint8_t tft_text_attr(uint8_t i) {
+  uint8_t a = disp_highlight(i) ? TFT_ATTR_HIGHLIGHT : 0;
+  if (!tft_lit && ((disp_blink >> i) & 0x01))
+    a |= TFT_ATTR_BLANK;
+  char sep = disp_separator(i);
+  if (sep)
+    a |= (disp_sep_kind(sep) + 1) << TFT_ATTR_SEP_SHIFT;
+  return a;
+}
+
+static void tft_draw_text_cell(uint8_t i) {
+  char c = disp_text[i];
+  uint8_t attr = tft_text_attr(i);
+  uint16_t segs = (attr & TFT_ATTR_BLANK) ? 0 : tft_char_segs(c);
+  uint16_t fg = (attr & TFT_ATTR_HIGHLIGHT) ? TFT_FG_HIGHLIGHT : TFT_FG;
+  uint8_t sep = attr >> TFT_ATTR_SEP_SHIFT;
+
+  tft_window(TFT_TEXT_X + (11 - i) * TFT_CELL_PITCH, TFT_TEXT_Y, TFT_CELL_PITCH, TFT_CHAR_H + TFT_STROKE);
+  for (uint8_t y = 0; y < TFT_CHAR_H + TFT_STROKE; y++) {
+    for (uint8_t x = 0; x < TFT_CELL_PITCH; x++) {
+      uint8_t on;
+      if (x < TFT_CHAR_W)
+	on = y < TFT_CHAR_H && tft_seg_pixel(segs, x, y, &tft_big);
+      else
+	on = sep && tft_sep_pixel(sep, x - TFT_CHAR_W, y);
+      tft_pixel(on ? fg : TFT_BG);
+    }
+  }
+  tft_text_shown[i] = c;
+  tft_attr_shown[i] = attr;
+}
+
+/* draw str, or blank if NULL, in small characters in a w pixels wide slot, only the characters that fit */
+static void tft_draw_slot(uint16_t x, uint16_t y, uint8_t w, const char *str) {
+  uint16_t segs[8];
+  uint8_t n = 0;
+  for (; str != NULL && str[n] != '\0' && n < sizeof(segs) / sizeof(segs[0]) && n < w / TFT_SMALL_PITCH; n++)
+    segs[n] = tft_char_segs(str[n]);
+
+  tft_window(x, y, w, TFT_SMALL_H);
+  for (uint8_t py = 0; py < TFT_SMALL_H; py++) {
+    for (uint8_t px = 0; px < w; px++) {
+      uint8_t j = px / TFT_SMALL_PITCH, cx = px % TFT_SMALL_PITCH;
+      uint8_t on = j < n && cx < TFT_SMALL_W && tft_seg_pixel(segs[j], cx, py, &tft_small);
+      tft_pixel(on ? TFT_FG : TFT_BG);
+    }
+  }
+}
+
+static void tft_draw_label_cell(uint8_t i) {
+  uint8_t k = 11 - i; // leftmost first
+  uint8_t on = (disp_state.labels >> i) & 0x01;
+  tft_draw_slot((k % 4) * TFT_SLOT_W, TFT_LABELS_Y + (k / 4) * TFT_SLOT_H, TFT_SLOT_W,
+		on ? hp_display_labels[k] : NULL);
+  tft_labels_shown = (tft_labels_shown & ~(1 << i)) | (on << i);
+}
+
+static void tft_draw_unit_cell(uint8_t i) {
+  uint8_t on = disp_unit_gate(i);
+  if (tft_unit_len[i] > 0) // not if it did not fit at all
+    tft_draw_slot(tft_unit_col[i] * TFT_SMALL_PITCH, TFT_UNITS_Y, tft_unit_len[i] * TFT_SMALL_PITCH,
+		  on ? hp_display_units_gate[i] : NULL);
+  tft_units_shown = (tft_units_shown & ~(1 << i)) | (on << i);
+}
+
+/* mark the cells that do not show what the decoder has */
+static void tft_mark_dirty() {
+  for (uint8_t i = 0; i < 12; i++) {
+    if (disp_text[i] != tft_text_shown[i] || tft_text_attr(i) != tft_attr_shown[i])
+      tft_dirty |= ((uint32_t) 1) << (TFT_CELL_TEXT + i);
+  }
+  tft_dirty |= ((uint32_t) (disp_state.labels ^ tft_labels_shown)) << TFT_CELL_LABEL;
+  tft_dirty |= ((uint32_t) (disp_state.units_gate ^ tft_units_shown)) << TFT_CELL_UNIT;
+}
+
+/*
+ * Place the units and Gate after each other, each as wide as its
+ * text, with a space between, as the profiles' units are from 1 to 7
+ * characters. What does not fit the row is cut, at whole characters.
+ */
+static void tft_units_layout() {
+  uint8_t col = 0;
+  for (uint8_t i = 0; i < 5; i++) {
+    uint8_t len = strlen(hp_display_units_gate[i]);
+    if (col > TFT_UNIT_COLS)
+      col = TFT_UNIT_COLS;
+    if (len > TFT_UNIT_COLS - col)
+      len = TFT_UNIT_COLS - col;
+    tft_unit_col[i] = col;
+    tft_unit_len[i] = len;
+    col += len + 1;
+  }
+}
+
+void tft_spi_setup() {
+  tft_pins_setup();
+  for (const uint8_t *p = tft_init_seq; pgm_read_byte(p) != 0; ) {
+    tft_write(0, pgm_read_byte(p++));
+    uint8_t n = pgm_read_byte(p++);
+    for (uint8_t i = 0; i < (n & ~TFT_DELAY); i++)
+      tft_write(1, pgm_read_byte(p++));
+    if (n & TFT_DELAY)
+      delay(pgm_read_byte(p++));
+  }
+  // clear, the only full screen write
+  tft_window(0, 0, TFT_WIDTH, TFT_HEIGHT);
+  for (uint32_t n = (uint32_t) TFT_WIDTH * TFT_HEIGHT; n > 0; n--)
+    tft_pixel(TFT_BG);
+  memset(tft_text_shown, ' ', sizeof(tft_text_shown));
+  tft_units_layout();
+}
+
+void tft_spi_update(uint16_t change) {
+  if (change & CHANGE_TEXT)
+    tft_lit = disp_blink_lit(millis());
+  tft_mark_dirty();
+}
+
+/*
+ * Blink the characters the decoder found blinking, see disp_blink, by
+ * redrawing just their cells.
+ */
+void tft_spi_blink() {
+  uint8_t lit = disp_blink_lit(millis());
+  if (lit == tft_lit)
+    return;
+  tft_lit = lit;
+  tft_mark_dirty();
+}
+
+/* draw the next changed cell, from the decoder's latest data */
+uint8_t tft_spi_step() {
+  if (tft_dirty == 0)
+    return 0;
+  uint8_t c = 0;
+  while (!((tft_dirty >> c) & 0x01))
+    c++;
+  tft_dirty &= ~(((uint32_t) 1) << c);
+  if (c < TFT_CELL_LABEL)
+    tft_draw_text_cell(c - TFT_CELL_TEXT);
+  else if (c < TFT_CELL_UNIT)
+    tft_draw_label_cell(c - TFT_CELL_LABEL);
+  else
+    tft_draw_unit_cell(c - TFT_CELL_UNIT);
+  tft_cells++;
+  return tft_dirty != 0;
+}
+
+void tft_spi_print() {
+  Serial.print(F("  panel: "));
+  Serial.print(TFT_WIDTH);
+  Serial.print('x');
+  Serial.print(TFT_HEIGHT);
+  Serial.print(F(", cells drawn: "));
+  Serial.print(tft_cells);
+  Serial.print(F(", a full redraw: "));
+  Serial.print((uint32_t) TFT_WIDTH * TFT_HEIGHT * 2);
+  Serial.println(F(" bytes"));
+}
+
+#endif // TFT_SPI
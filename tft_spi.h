@@ -0,0 +1,52 @@
+/*
+ * hp_display - program for Arduino for replacing the display on some
+ * discontinued HP/Agilent/Keysight instruments.
+ * Copyright (C) 2019  Ragnar Sundblad
+ * 
+ * This file is part of the hp_display program.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifdef TFT_SPI
+
+#ifdef TFT_ILI9341
+#define TFT_WIDTH 320
+#define TFT_HEIGHT 240
+#else
+#define TFT_WIDTH 160
+#define TFT_HEIGHT 128
+#endif
+
+// refresh limits, see hp_disp_sink.cpp
+#ifndef TFT_MIN_INTERVAL_MS
+#define TFT_MIN_INTERVAL_MS 50
+#endif
+#ifndef TFT_HOLD_MS
+#define TFT_HOLD_MS 100
+#endif
+
+void tft_spi_setup();
+// note what change, CHANGE_* bits, says needs redrawing, see tft_spi_step()
+void tft_spi_update(uint16_t change);
+// toggle the blinking characters, call from loop()
+void tft_spi_blink();
+// draw the next changed cell, returns nonzero while there are more, call from loop()
+uint8_t tft_spi_step();
+void tft_spi_print(); // panel and cell statistics
+
+extern uint32_t tft_bytes; // command and data bytes sent
+
+#endif // TFT_SPI
@@ -0,0 +1,118 @@
+
+/*
+ * hp_display - program for Arduino for replacing the display on some
+ * discontinued HP/Agilent/Keysight instruments.
+ * Copyright (C) 2019  Ragnar Sundblad
+ *
+ * This file is part of the hp_display program.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* generated by extras/glyphwidths.py from helvB10-mod.bdf, do not edit */
+
+#define LABEL_GLYPH_FIRST 0x20
+
+/* x advance of the label characters, from LABEL_GLYPH_FIRST, 0 if not a label character */
+const uint8_t label_glyph_widths[89] PROGMEM = {
+ 4, // ' '
+ 0,
+ 0,
+ 0,
+ 0,
+ 0,
+ 0,
+ 0,
+ 0,
+ 0,
+ 6, // '*'
+ 9, // '+'
+ 0,
+ 4, // '-'
+ 0,
+ 0,
+ 0,
+ 8, // '1'
+ 8, // '2'
+ 8, // '3'
+ 0,
+ 0,
+ 0,
+ 0,
+ 0,
+ 0,
+ 0,
+ 0,
+ 0,
+ 0,
+ 0,
+ 0,
+ 0,
+10, // 'A'
+ 0,
+11, // 'C'
+ 0,
+ 9, // 'E'
+ 9, // 'F'
+ 0,
+10, // 'H'
+ 0,
+ 0,
+ 0,
+ 8, // 'L'
+13, // 'M'
+ 0,
+12, // 'O'
+10, // 'P'
+ 0,
+11, // 'R'
+10, // 'S'
+ 8, // 'T'
+ 0,
+ 0,
+14, // 'W'
+ 0,
+ 0,
+ 0,
+ 0,
+ 0,
+ 0,
+ 0,
+ 0,
+ 0,
+ 8, // 'a'
+ 0,
+ 0,
+ 9, // 'd'
+ 8, // 'e'
+ 4, // 'f'
+ 9, // 'g'
+ 9, // 'h'
+ 4, // 'i'
+ 0,
+ 0,
+ 4, // 'l'
+12, // 'm'
+ 9, // 'n'
+ 9, // 'o'
+ 0,
+ 9, // 'q'
+ 6, // 'r'
+ 8, // 's'
+ 5, // 't'
+ 0,
+ 0,
+ 0,
+ 7, // 'x'
+};